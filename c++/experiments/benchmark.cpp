@@ -0,0 +1,547 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include "kth_statistic.h"
+#include "kth_statistic_stl.h"
+#include "kth_statistic_hoare.h"
+#include "kth_statistic_floyd_rivest.h"
+#include "kth_statistic_predictor_simple.h"
+#include "kth_statistic_predictor_destructive.h"
+#include "kth_statistic_predictor_parallel.h"
+#include "kth_statistic_radix.h"
+#include "kth_statistic_batch.h"
+#include "generators.h"
+#include "util.h"
+
+/*
+ * A configurable benchmark driver: unlike performance.exe, which runs a fixed matrix of measurements,
+ * this one runs the selected algorithms on the selected element types, sizes, values of k and distributions.
+ * Every measurement is repeated, and the median, the minimum and the maximum times are reported,
+ * as text, CSV or JSON. Run with --help for the options.
+ */
+
+char const *all_algorithms[] = {
+    "stl", "hoare", "introspective-hoare", "floyd-rivest", "floyd-rivest-aux", "predicting-fixed", "predicting-tuned",
+    "predicting-policy", "predicting-random", "predicting-blocks", "predicting-profiled", "predicting-adaptive", "destructive-tuned", "recursive-fixed", "recursive-tuned", "parallel-tuned", "radix-8", "radix-11", "batched"
+};
+char const *all_types[] = { "int", "int64", "float", "double" };
+char const *all_distributions[] = {
+    "uniform", "increasing", "decreasing", "few-unique", "zipf", "organ-pipe", "sawtooth",
+    "nearly-sorted", "stride-periodic", "hoare-killer", "replay"
+};
+
+struct config {
+    std::vector<std::string> algorithms, types, distributions;
+    std::vector<size_t> sizes;
+    std::vector<double> k_fractions;
+    size_t elements, warmup, repetitions, threads;
+    int cpu;
+    std::string format, replay, profile, pages, operation;
+    uint64_t seed;
+
+    config()
+    : algorithms(std::begin(all_algorithms), std::end(all_algorithms)),
+      types({ "int", "double" }),
+      distributions({ "uniform", "increasing", "decreasing" }),
+      sizes({ 1000, 1000000 }),
+      k_fractions({ 0.5 }),
+      elements(10000000), warmup(1), repetitions(5), threads(0), cpu(-1),
+      format("text"), pages("heap"), operation("find"), seed(12314342342342ULL) {}
+};
+
+void usage(char const *program) {
+    config defaults;
+    auto list = [](auto const &begin, auto const &end) {
+        std::ostringstream out;
+        for (auto it = begin; it != end; ++it) {
+            out << (it == begin ? "" : ",") << *it;
+        }
+        return out.str();
+    };
+    std::cerr << "Usage: " << program << " [<option> <value>]...\n"
+              << "Lists are comma-separated. Options:\n"
+              << "    --algorithms <list>     of " << list(std::begin(all_algorithms), std::end(all_algorithms))
+              << " (default: all)\n"
+              << "    --types <list>          of " << list(std::begin(all_types), std::end(all_types))
+              << " (default: " << list(defaults.types.begin(), defaults.types.end()) << ")\n"
+              << "    --distributions <list>  of " << list(std::begin(all_distributions), std::end(all_distributions))
+              << "\n                            (default: " << list(defaults.distributions.begin(), defaults.distributions.end())
+              << "; hoare-killer is built for k = size / 2)\n"
+              << "    --sizes <list>          array sizes, like 1000,1e6 (default: "
+              << list(defaults.sizes.begin(), defaults.sizes.end()) << ")\n"
+              << "    --k <list>              k as fractions of the size, in [0, 1] (default: 0.5)\n"
+              << "    --operation <o>         find, partition to time partition_at, or batch to time find_batch\n"
+              << "                            over all the arrays, which is a find for each of them except for batched\n"
+              << "                            (default: find)\n"
+              << "    --elements <n>          elements per measurement, split into arrays of the given size (default: "
+              << defaults.elements << ")\n"
+              << "    --warmup <n>            untimed runs before the measurement (default: " << defaults.warmup << ")\n"
+              << "    --repetitions <n>       timed runs of the measurement (default: " << defaults.repetitions << ")\n"
+              << "    --threads <n>           threads of the parallel algorithms (default: all hardware threads)\n"
+              << "    --cpu <n>               pin to this CPU, together with all threads (default: no pinning)\n"
+              << "    --format <f>            text, csv or json (default: text)\n"
+              << "    --seed <n>              random seed (default: " << defaults.seed << ")\n"
+              << "    --pages <p>             the memory of the shared workspace: heap, 4k or huge (default: heap)\n"
+              << "    --profile <file>        the sample size profile of predicting-profiled, from `tuning.exe --autotune`\n"
+              << "    --replay <file>         the file of raw elements of the selected types for the replay distribution"
+              << std::endl;
+}
+
+[[noreturn]] void fail(char const *program, std::string const &message) {
+    std::cerr << "Error: " << message << "\n" << std::endl;
+    usage(program);
+    std::exit(1);
+}
+
+std::vector<std::string> split(std::string const &value) {
+    std::vector<std::string> result;
+    std::istringstream in(value);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        result.push_back(item);
+    }
+    return result;
+}
+
+bool parse_number(std::string const &value, double &result) {
+    char *end = nullptr;
+    result = std::strtod(value.c_str(), &end);
+    return !value.empty() && *end == 0;
+}
+
+bool parse_count(std::string const &value, size_t &result) {
+    double number;
+    if (!parse_number(value, number) || number < 0 || number != double(size_t(number))) {
+        return false;
+    }
+    result = size_t(number);
+    return true;
+}
+
+template<size_t n>
+void check_names(char const *program, char const *option,
+                 std::vector<std::string> const &values, char const *(&allowed)[n]) {
+    for (std::string const &value : values) {
+        if (std::find_if(allowed, allowed + n, [&](char const *a) { return value == a; }) == allowed + n) {
+            fail(program, std::string("unknown value '") + value + "' of " + option);
+        }
+    }
+}
+
+config parse(int argc, char *argv[]) {
+    config result;
+    char const *program = argv[0];
+    bool algorithms_given = false;
+    for (int i = 1; i < argc; i += 2) {
+        std::string option = argv[i];
+        if (option == "--help" || option == "-h") {
+            usage(program);
+            std::exit(0);
+        }
+        if (i + 1 == argc) {
+            fail(program, "no value for " + option);
+        }
+        std::string value = argv[i + 1];
+        size_t count;
+        if (option == "--algorithms") {
+            check_names(program, "--algorithms", result.algorithms = split(value), all_algorithms);
+            algorithms_given = true;
+        } else if (option == "--types") {
+            check_names(program, "--types", result.types = split(value), all_types);
+        } else if (option == "--distributions") {
+            check_names(program, "--distributions", result.distributions = split(value), all_distributions);
+        } else if (option == "--sizes") {
+            result.sizes.clear();
+            for (std::string const &item : split(value)) {
+                if (!parse_count(item, count) || count == 0) {
+                    fail(program, "invalid size '" + item + "'");
+                }
+                result.sizes.push_back(count);
+            }
+        } else if (option == "--k") {
+            result.k_fractions.clear();
+            for (std::string const &item : split(value)) {
+                double fraction;
+                if (!parse_number(item, fraction) || fraction < 0 || fraction > 1) {
+                    fail(program, "invalid fraction of k '" + item + "'");
+                }
+                result.k_fractions.push_back(fraction);
+            }
+        } else if (option == "--operation") {
+            if (value != "find" && value != "partition" && value != "batch") {
+                fail(program, "unknown operation '" + value + "'");
+            }
+            result.operation = value;
+        } else if (option == "--pages") {
+            if (value != "heap" && value != "4k" && value != "huge") {
+                fail(program, "unknown pages '" + value + "'");
+            }
+            result.pages = value;
+        } else if (option == "--profile") {
+            result.profile = value;
+        } else if (option == "--replay") {
+            result.replay = value;
+        } else if (option == "--format") {
+            if (value != "text" && value != "csv" && value != "json") {
+                fail(program, "unknown format '" + value + "'");
+            }
+            result.format = value;
+        } else if (option == "--cpu") {
+            if (!parse_count(value, count)) {
+                fail(program, "invalid CPU '" + value + "'");
+            }
+            result.cpu = int(count);
+        } else if (option == "--seed") {
+            char *end = nullptr;
+            result.seed = std::strtoull(value.c_str(), &end, 10);
+            if (value.empty() || *end != 0) {
+                fail(program, "invalid seed '" + value + "'");
+            }
+        } else if (option == "--elements" || option == "--warmup" || option == "--repetitions" || option == "--threads") {
+            if (!parse_count(value, count) || (count == 0 && option != "--warmup")) {
+                fail(program, "invalid value '" + value + "' of " + option);
+            }
+            (option == "--elements" ? result.elements
+             : option == "--warmup" ? result.warmup
+             : option == "--repetitions" ? result.repetitions
+             : result.threads) = count;
+        } else {
+            fail(program, "unknown option " + option);
+        }
+    }
+    auto profiled = std::find(result.algorithms.begin(), result.algorithms.end(), "predicting-profiled");
+    if (result.profile.empty() && profiled != result.algorithms.end()) {
+        if (algorithms_given) {
+            fail(program, "predicting-profiled needs --profile <file>");
+        }
+        result.algorithms.erase(profiled);
+    }
+    if (result.replay.empty() && std::find(result.distributions.begin(), result.distributions.end(), "replay")
+                                 != result.distributions.end()) {
+        fail(program, "the replay distribution needs --replay <file>");
+    }
+    return result;
+}
+
+void pin_to_cpu(int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        std::perror("sched_setaffinity");
+        std::exit(1);
+    }
+#else
+    std::cerr << "Error: pinning to a CPU is not supported on this platform" << std::endl;
+    std::exit(1);
+#endif
+}
+
+// Everything the algorithms may need, living for the whole run.
+// All algorithms of all types share a workspace, as they run one at a time.
+struct environment {
+    fixed_ratio_sample_sizes fss;
+    tuned_ratio_sample_sizes tss;
+    tuned_ratio_policy trp;
+    profiled_sample_sizes pss;
+    adaptive_sample_sizes ass;
+    thread_pool pool;
+    workspace ws;
+
+    environment(size_t threads, page_policy pages) : fss(10, 10), pool(threads), ws(pages) {}
+};
+
+// batched_kth_statistic on predicting-policy, which it owns
+template<typename element_t>
+struct batched_on_predicting : batched_kth_statistic<element_t> {
+    // only its reference is taken before it is constructed
+    predicting_kth_statistic<element_t, tuned_ratio_policy> predicting;
+
+    explicit batched_on_predicting(environment &env)
+    : batched_kth_statistic<element_t>(predicting, "batched"), predicting(env.trp, "predicting-policy", 1, 0, &env.ws) {}
+};
+
+template<typename element_t>
+std::unique_ptr< kth_statistic<element_t> > make_algorithm(std::string const &id, environment &env) {
+    typedef std::unique_ptr< kth_statistic<element_t> > ptr;
+    if (id == "stl") return ptr(new stl_kth_statistic<element_t>());
+    if (id == "hoare") return ptr(new bidirectional_hoare_middle<element_t>());
+    if (id == "introspective-hoare") return ptr(new introspective_hoare<element_t>("introspective-hoare"));
+    if (id == "floyd-rivest") return ptr(new floyd_rivest_kth_statistic<element_t>("floyd-rivest"));
+    if (id == "floyd-rivest-aux") return ptr(new floyd_rivest_aux_kth_statistic<element_t>("floyd-rivest-aux", 1, &env.ws));
+    if (id == "predicting-fixed") return ptr(new predicting_kth_statistic<element_t>(env.fss, "predicting-fixed", 1, 0, &env.ws));
+    if (id == "predicting-tuned") return ptr(new predicting_kth_statistic<element_t>(env.tss, "predicting-tuned", 1, 0, &env.ws));
+    if (id == "predicting-policy") {
+        return ptr(new predicting_kth_statistic<element_t, tuned_ratio_policy>(env.trp, "predicting-policy", 1, 0, &env.ws));
+    }
+    if (id == "predicting-random") {
+        return ptr(new predicting_kth_statistic<element_t, tuned_ratio_policy, random_sampling>(env.trp, "predicting-random", 1, 0, &env.ws));
+    }
+    if (id == "predicting-blocks") {
+        return ptr(new predicting_kth_statistic<element_t, tuned_ratio_policy, block_sampling>(env.trp, "predicting-blocks", 1, 0, &env.ws));
+    }
+    if (id == "predicting-profiled") {
+        return ptr(new predicting_kth_statistic<element_t>(env.pss, "predicting-profiled", 1, 0, &env.ws));
+    }
+    if (id == "predicting-adaptive") {
+        return ptr(new predicting_kth_statistic<element_t>(env.ass, "predicting-adaptive", 1, 0, &env.ws));
+    }
+    if (id == "destructive-tuned") {
+        return ptr(new destructive_predicting_kth_statistic<element_t>(env.tss, "destructive-tuned", &env.ws));
+    }
+    if (id == "recursive-fixed") return ptr(new predicting_kth_statistic<element_t>(env.fss, "recursive-fixed", 1, 2, &env.ws));
+    if (id == "recursive-tuned") return ptr(new predicting_kth_statistic<element_t>(env.tss, "recursive-tuned", 1, 2, &env.ws));
+    if (id == "parallel-tuned") {
+        return ptr(new parallel_predicting_kth_statistic<element_t>(env.tss, env.pool, "parallel-tuned", 1, &env.ws));
+    }
+    if (id == "radix-8") return ptr(new radix_kth_statistic<element_t, 8>("radix-8", 1, &env.ws));
+    if (id == "radix-11") return ptr(new radix_kth_statistic<element_t, 11>("radix-11", 1, &env.ws));
+    if (id == "batched") return ptr(new batched_on_predicting<element_t>(env));
+    return ptr();
+}
+
+template<typename element_t>
+std::vector< std::unique_ptr< sequence_changer<element_t> > > make_distribution(std::string const &id,
+                                                                               config const &cfg,
+                                                                               environment &env,
+                                                                               std::mt19937_64 &rng) {
+    typedef std::unique_ptr< sequence_changer<element_t> > ptr;
+    std::vector<ptr> result;
+    if (id == "few-unique") {
+        result.emplace_back(new few_unique_generator<element_t, std::mt19937_64>(rng, 10));
+    } else if (id == "zipf") {
+        result.emplace_back(new zipf_generator<element_t, std::mt19937_64>(rng, 10000, 1.1));
+    } else if (id == "stride-periodic") {
+        element_t scale = std::is_integral_v<element_t> ? element_t(1000000) : element_t(1);
+        result.emplace_back(new stride_periodic_generator<element_t, std::mt19937_64>(rng, env.tss, scale));
+    } else if (id == "hoare-killer") {
+        result.emplace_back(new hoare_middle_killer<element_t>(2));
+    } else if (id == "replay") {
+        result.emplace_back(new file_replayer<element_t>(cfg.replay.c_str()));
+    } else if constexpr (std::is_integral_v<element_t>) {
+        element_t bound = std::numeric_limits<element_t>::max() / 2;
+        result.emplace_back(new uniform_int_generator<element_t, std::mt19937_64>(rng, -bound, +bound));
+    } else {
+        result.emplace_back(new uniform_real_generator<element_t, std::mt19937_64>(rng, -1, +1));
+    }
+
+    if (id == "increasing" || id == "nearly-sorted") {
+        result.emplace_back(new sorter<element_t, std::less<element_t> >());
+    } else if (id == "decreasing") {
+        result.emplace_back(new sorter<element_t, std::greater<element_t> >());
+    } else if (id == "organ-pipe") {
+        result.emplace_back(new organ_pipe<element_t>());
+    } else if (id == "sawtooth") {
+        result.emplace_back(new sawtooth<element_t>(16));
+    }
+    if (id == "nearly-sorted") {
+        result.emplace_back(new random_swapper<element_t, std::mt19937_64>(rng, 1));
+    }
+    return result;
+}
+
+struct measurement {
+    std::string type, distribution, algorithm;
+    size_t size, k, count, repetitions;
+    double min_seconds, median_seconds, max_seconds;
+};
+
+class reporter {
+    std::string _format;
+    size_t _n_reported;
+
+public:
+    reporter(std::string const &format) : _format(format), _n_reported(0) {
+        if (_format == "csv") {
+            std::cout << "type,distribution,size,k,count,algorithm,repetitions,"
+                      << "min_seconds,median_seconds,max_seconds,median_ns_per_element" << std::endl;
+        } else if (_format == "json") {
+            std::cout << "[";
+        }
+    }
+
+    void report(measurement const &m) {
+        double ns_per_element = m.median_seconds * 1e9 / double(m.size) / double(m.count);
+        if (_format == "csv") {
+            std::cout << m.type << "," << m.distribution << "," << m.size << "," << m.k << "," << m.count << ","
+                      << m.algorithm << "," << m.repetitions << ","
+                      << std::setprecision(6) << std::scientific
+                      << m.min_seconds << "," << m.median_seconds << "," << m.max_seconds << ","
+                      << std::setprecision(4) << std::fixed << ns_per_element << std::endl;
+        } else if (_format == "json") {
+            std::cout << (_n_reported == 0 ? "\n" : ",\n")
+                      << "  {\"type\": \"" << m.type << "\", \"distribution\": \"" << m.distribution
+                      << "\", \"size\": " << m.size << ", \"k\": " << m.k << ", \"count\": " << m.count
+                      << ", \"algorithm\": \"" << m.algorithm << "\", \"repetitions\": " << m.repetitions
+                      << std::setprecision(6) << std::scientific
+                      << ", \"min_seconds\": " << m.min_seconds
+                      << ", \"median_seconds\": " << m.median_seconds
+                      << ", \"max_seconds\": " << m.max_seconds
+                      << std::setprecision(4) << std::fixed
+                      << ", \"median_ns_per_element\": " << ns_per_element << "}";
+        } else {
+            std::cout << "    " << std::setw(20) << m.algorithm
+                      << ": median " << std::setprecision(4) << std::scientific << m.median_seconds
+                      << "s (min " << m.min_seconds << "s, max " << m.max_seconds << "s), "
+                      << std::setprecision(4) << std::fixed << ns_per_element << " ns per element" << std::endl;
+        }
+        ++_n_reported;
+    }
+
+    void header(measurement const &m) {
+        if (_format == "text") {
+            std::cout << "Measurement '" << m.distribution << "', type = " << m.type
+                      << ", size = " << m.size << ", k = " << m.k << ", count = " << m.count
+                      << ", repetitions = " << m.repetitions << ":" << std::endl;
+        }
+    }
+
+    ~reporter() {
+        if (_format == "json") {
+            std::cout << "\n]" << std::endl;
+        }
+    }
+};
+
+template<typename element_t>
+void run_type(char const *type, config const &cfg, environment &env, reporter &out) {
+    std::vector< std::unique_ptr< kth_statistic<element_t> > > algorithms;
+    for (std::string const &id : cfg.algorithms) {
+        algorithms.push_back(make_algorithm<element_t>(id, env));
+    }
+    std::mt19937_64 rng(cfg.seed);
+    bool partition = cfg.operation == "partition";
+    bool batch = cfg.operation == "batch";
+
+    for (std::string const &distribution : cfg.distributions) {
+        auto changers = make_distribution<element_t>(distribution, cfg, env, rng);
+        for (size_t size : cfg.sizes) {
+            size_t count = std::max<size_t>(1, cfg.elements / size);
+            std::vector<element_t> reference(size * count), working(size * count);
+            std::vector<element_t *> starts(count);
+            for (size_t i = 0; i < count; ++i) {
+                starts[i] = working.data() + i * size;
+            }
+            for (size_t i = 0; i < count; ++i) {
+                for (auto const &changer : changers) {
+                    changer->generate(reference.data() + i * size, size);
+                }
+            }
+
+            for (double fraction : cfg.k_fractions) {
+                size_t k = std::min(size - 1, size_t(fraction * double(size)));
+                std::vector<element_t> expected(count), results(count);
+                working = reference;
+                for (size_t i = 0; i < count; ++i) {
+                    element_t *array = working.data() + i * size;
+                    std::nth_element(array, array + k, array + size);
+                    expected[i] = array[k];
+                }
+
+                measurement m = { type, distribution, "", size, k, count, cfg.repetitions, 0, 0, 0 };
+                out.header(m);
+                for (size_t idx = 0; idx < algorithms.size(); ++idx) {
+                    kth_statistic<element_t> *algorithm = algorithms[idx].get();
+                    algorithm->resize(size);
+                    std::vector<double> times;
+                    for (size_t run = 0; run < cfg.warmup + cfg.repetitions; ++run) {
+                        array_copy(reference.data(), reference.size(), working.data());
+                        const auto start = std::chrono::high_resolution_clock::now();
+                        if (partition) {
+                            for (size_t i = 0; i < count; ++i) {
+                                algorithm->partition_at(working.data() + i * size, size, k);
+                            }
+                        } else if (batch) {
+                            algorithm->find_batch(starts.data(), count, size, k, results.data());
+                        } else {
+                            for (size_t i = 0; i < count; ++i) {
+                                results[i] = algorithm->find(working.data() + i * size, size, k);
+                            }
+                        }
+                        const auto finish = std::chrono::high_resolution_clock::now();
+                        if (partition) {
+                            for (size_t i = 0; i < count; ++i) {
+                                element_t const *array = working.data() + i * size;
+                                results[i] = array[k];
+                                if (std::any_of(array, array + k, [&](element_t x) { return array[k] < x; })
+                                    || std::any_of(array + k, array + size, [&](element_t x) { return x < array[k]; })) {
+                                    std::cerr << "Error: " << cfg.algorithms[idx] << " did not partition "
+                                              << distribution << " " << type << ", size = " << size
+                                              << ", k = " << k << std::endl;
+                                    std::exit(1);
+                                }
+                            }
+                        }
+                        if (results != expected) {
+                            std::cerr << "Error: " << cfg.algorithms[idx] << " returned a wrong result on "
+                                      << distribution << " " << type << ", size = " << size
+                                      << ", k = " << k << std::endl;
+                            std::exit(1);
+                        }
+                        if (run >= cfg.warmup) {
+                            times.push_back(std::chrono::duration<double>(finish - start).count());
+                        }
+                    }
+                    std::sort(times.begin(), times.end());
+                    m.algorithm = cfg.algorithms[idx];
+                    m.min_seconds = times.front();
+                    m.max_seconds = times.back();
+                    m.median_seconds = times.size() % 2 == 1 ? times[times.size() / 2]
+                                       : (times[times.size() / 2 - 1] + times[times.size() / 2]) / 2;
+                    out.report(m);
+                }
+            }
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    config cfg = parse(argc, argv);
+
+    // before the thread pool is created, so that its threads are pinned as well
+    if (cfg.cpu >= 0) {
+        pin_to_cpu(cfg.cpu);
+    }
+    size_t threads = cfg.threads > 0 ? cfg.threads : std::max(1u, std::thread::hardware_concurrency());
+    page_policy pages = cfg.pages == "huge" ? page_policy::huge_pages
+                        : cfg.pages == "4k" ? page_policy::small_pages
+                        : page_policy::heap;
+    environment env(threads, pages);
+    if (!cfg.profile.empty() && !env.pss.load(cfg.profile.c_str())) {
+        std::cerr << "Error: cannot load the sample size profile " << cfg.profile << std::endl;
+        std::exit(1);
+    }
+
+    reporter out(cfg.format);
+    for (std::string const &type : cfg.types) {
+        if (type == "int") {
+            run_type<int>("int", cfg, env, out);
+        } else if (type == "int64") {
+            run_type<int64_t>("int64", cfg, env, out);
+        } else if (type == "float") {
+            run_type<float>("float", cfg, env, out);
+        } else if (type == "double") {
+            run_type<double>("double", cfg, env, out);
+        }
+    }
+    return 0;
+}
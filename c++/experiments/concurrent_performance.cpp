@@ -0,0 +1,186 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "generators.h"
+#include "kth_statistic.h"
+#include "kth_statistic_concurrent.h"
+#include "kth_statistic_predictor_simple.h"
+#include "thread_pool.h"
+
+/*
+ * The throughput of many threads calling find at once, each on its own arrays, for 1 to N threads:
+ * with an engine for every thread, which is the best case and the usual way, with one concurrent engine
+ * for all of them, and with one predicting engine behind a mutex, which is what sharing used to take.
+ * The work per thread is fixed, so with perfect scaling the throughput grows as the number of threads.
+ */
+template<typename element_t>
+struct contender {
+    virtual char const *name() const = 0;
+    virtual element_t find(size_t thread, element_t *start, size_t size, size_t k) = 0;
+    virtual void display_and_reset_statistics(std::ostream &out) {}
+    virtual ~contender() {}
+};
+
+template<typename element_t>
+struct engine_per_thread : contender<element_t> {
+    std::vector< std::unique_ptr< predicting_kth_statistic<element_t, tuned_ratio_policy> > > engines;
+
+    engine_per_thread(tuned_ratio_policy &policy, size_t n_threads) {
+        for (size_t i = 0; i < n_threads; ++i) {
+            engines.emplace_back(new predicting_kth_statistic<element_t, tuned_ratio_policy>(policy, name()));
+        }
+    }
+
+    char const *name() const { return "predicting kth, tuned policy, an engine per thread"; }
+
+    element_t find(size_t thread, element_t *start, size_t size, size_t k) {
+        return engines[thread]->find(start, size, k);
+    }
+};
+
+template<typename element_t>
+struct shared_concurrent : contender<element_t> {
+    concurrent_kth_statistic<element_t, tuned_ratio_policy> engine;
+
+    explicit shared_concurrent(tuned_ratio_policy &policy) : engine(policy, "concurrent predicting kth, tuned policy, shared") {}
+
+    char const *name() const { return engine.name(); }
+
+    element_t find(size_t, element_t *start, size_t size, size_t k) {
+        return engine.find(start, size, k);
+    }
+
+    void display_and_reset_statistics(std::ostream &out) {
+        engine.display_and_reset_statistics(out);
+    }
+};
+
+template<typename element_t>
+struct shared_locked : contender<element_t> {
+    predicting_kth_statistic<element_t, tuned_ratio_policy> engine;
+    std::mutex mutex;
+
+    explicit shared_locked(tuned_ratio_policy &policy) : engine(policy, "predicting kth, tuned policy, shared with a mutex") {}
+
+    char const *name() const { return engine.name(); }
+
+    element_t find(size_t, element_t *start, size_t size, size_t k) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return engine.find(start, size, k);
+    }
+};
+
+template<typename element_t>
+void measure(char const *measurement_name, size_t size, size_t n_threads,
+             sequence_changer<element_t> &generator,
+             std::vector< contender<element_t>* > const &contenders,
+             std::vector<double> &single_thread_rates) {
+    // every thread calls find on its own arrays, which together are large enough not to stay in the cache
+    const size_t elements_per_thread = 10000000;
+    const size_t n_arrays = std::max<size_t>(1, (size_t(1) << 20) / size);
+    const size_t n_calls = std::max<size_t>(1, elements_per_thread / size);
+    const size_t k = size / 2;
+
+    std::cout << "Measurement '" << measurement_name
+              << "', size = " << size
+              << ", threads = " << n_threads
+              << ":" << std::endl;
+
+    size_t algo_width = 0;
+    for (auto c : contenders) {
+        algo_width = std::max(algo_width, strlen(c->name()));
+    }
+
+    std::vector< std::vector<element_t> > arrays(n_threads, std::vector<element_t>(n_arrays * size));
+    for (auto &thread_arrays : arrays) {
+        generator.generate(thread_arrays.data(), thread_arrays.size());
+    }
+    thread_pool pool(n_threads);
+    std::vector<element_t> checksums(n_threads);
+    std::vector<element_t> expected_checksums;
+
+    for (size_t c = 0; c < contenders.size(); ++c) {
+        contender<element_t> *algorithm = contenders[c];
+        const auto start = std::chrono::high_resolution_clock::now();
+        pool.run(n_threads, [&](size_t t) {
+            element_t sum = element_t();
+            for (size_t call = 0; call < n_calls; ++call) {
+                sum += algorithm->find(t, arrays[t].data() + call % n_arrays * size, size, k);
+            }
+            checksums[t] = sum;
+        });
+        const auto finish = std::chrono::high_resolution_clock::now();
+        // the arrays may be permuted, but the k-th elements are the same for all
+        if (c == 0) {
+            expected_checksums = checksums;
+        } else if (checksums != expected_checksums) {
+            std::cerr << "Error: " << algorithm->name() << " found other elements than " << contenders[0]->name() << std::endl;
+            std::exit(1);
+        }
+
+        const std::chrono::duration<double> elapsed_seconds(finish - start);
+        const double rate = double(n_threads) * double(n_calls) * double(size) / elapsed_seconds.count();
+        if (n_threads == 1) {
+            single_thread_rates[c] = rate;
+        }
+
+        std::cout << "    " << std::setw(algo_width) << algorithm->name()
+                  << ": " << std::setprecision(4) << std::scientific << elapsed_seconds
+                  << ", " << std::setprecision(4) << std::scientific << rate << " elements/s"
+                  << ", " << std::setprecision(2) << std::fixed << rate / single_thread_rates[c]
+                  << "x one thread" << std::endl;
+        algorithm->display_and_reset_statistics(std::cout);
+    }
+}
+
+template<typename element_t>
+void measure_scaling(char const *measurement_name, size_t max_threads,
+                     sequence_changer<element_t> &generator,
+                     std::vector< contender<element_t>* > const &contenders) {
+    size_t sizes[] = { 100, 10000, 1000000 };
+    for (size_t size : sizes) {
+        std::vector<double> single_thread_rates(contenders.size());
+        for (size_t n_threads = 1; ; n_threads = std::min(2 * n_threads, max_threads)) {
+            measure(measurement_name, size, n_threads, generator, contenders, single_thread_rates);
+            if (n_threads == max_threads) {
+                break;
+            }
+        }
+        std::cout << std::endl;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+    if (argc > 2 || (argc == 2 && (max_threads = std::atoi(argv[1])) < 1)) {
+        std::cerr << "Usage: " << argv[0] << " [<max threads, at least 1; default the number of hardware threads>]" << std::endl;
+        std::exit(1);
+    }
+    std::mt19937_64 rng(12314342342342LL);
+    tuned_ratio_policy trp;
+
+    engine_per_thread<int> per_thread_int(trp, max_threads);
+    shared_concurrent<int> concurrent_int(trp);
+    shared_locked<int> locked_int(trp);
+    engine_per_thread<double> per_thread_dbl(trp, max_threads);
+    shared_concurrent<double> concurrent_dbl(trp);
+    shared_locked<double> locked_dbl(trp);
+
+    uniform_int_generator<int, std::mt19937_64> gen_int(rng, -1000000000, +1000000000);
+    uniform_real_generator<double, std::mt19937_64> gen_dbl(rng, -1.0, +1.0);
+
+    std::cout << "********* Int, concurrent calls **********\n" << std::endl;
+    measure_scaling<int>("UniformInt[-1e9, +1e9]", max_threads, gen_int, { &per_thread_int, &concurrent_int, &locked_int });
+
+    std::cout << "********* Double, concurrent calls **********\n" << std::endl;
+    measure_scaling<double>("UniformDouble[-1, +1]", max_threads, gen_dbl, { &per_thread_dbl, &concurrent_dbl, &locked_dbl });
+    return 0;
+}
@@ -0,0 +1,262 @@
+#pragma once
+
+/*
+ * Generators of the benchmark inputs.
+ *
+ * A sequence_changer either fills an array with new values, or transforms the values already there,
+ * so that an input is described by a list of them, e.g. a uniform generator followed by a sorter.
+ *
+ * Besides the uniform random inputs, which are very favorable to strided sampling, there are
+ * inputs with many equal values, with long runs, with patterns aligned to the sampling stride,
+ * inputs which are adversarial to the middle-pivot Hoare selection, and real data replayed from a file.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+#include "kth_statistic_predictor_simple.h"
+
+template<typename element_t>
+struct sequence_changer {
+    virtual void generate(element_t *array, size_t size) = 0;
+    virtual ~sequence_changer() {}
+};
+
+template<typename element_t, typename rng_t>
+struct uniform_int_generator : sequence_changer<element_t> {
+    rng_t &rng;
+    element_t min, max;
+
+    uniform_int_generator(rng_t &rng, element_t min, element_t max): rng(rng), min(min), max(max) {}
+
+    void generate(element_t *array, size_t size) {
+        std::uniform_int_distribution<element_t> value_gen(min, max);
+        for (size_t i = 0; i < size; ++i) {
+            array[i] = value_gen(rng);
+        }
+    }
+};
+
+template<typename element_t, typename rng_t>
+struct uniform_real_generator : sequence_changer<element_t> {
+    rng_t &rng;
+    element_t min, max;
+
+    uniform_real_generator(rng_t &rng, element_t min, element_t max): rng(rng), min(min), max(max) {}
+
+    void generate(element_t *array, size_t size) {
+        std::uniform_real_distribution<element_t> value_gen(min, max);
+        for (size_t i = 0; i < size; ++i) {
+            array[i] = value_gen(rng);
+        }
+    }
+};
+
+template<typename element_t, typename comparator_t>
+struct sorter : sequence_changer<element_t> {
+    comparator_t cmp;
+
+    void generate(element_t *array, size_t size) {
+        std::sort(array, array + size, cmp);
+    }
+};
+
+// Shuffles the values randomly
+template<typename element_t, typename rng_t>
+struct shuffler : sequence_changer<element_t> {
+    rng_t &rng;
+
+    shuffler(rng_t &rng): rng(rng) {}
+
+    void generate(element_t *array, size_t size) {
+        std::shuffle(array, array + size, rng);
+    }
+};
+
+// Only a few distinct values: 0, 1, ..., n_unique - 1, chosen uniformly
+template<typename element_t, typename rng_t>
+struct few_unique_generator : sequence_changer<element_t> {
+    rng_t &rng;
+    size_t n_unique;
+
+    few_unique_generator(rng_t &rng, size_t n_unique): rng(rng), n_unique(n_unique) {}
+
+    void generate(element_t *array, size_t size) {
+        std::uniform_int_distribution<size_t> value_gen(0, n_unique - 1);
+        for (size_t i = 0; i < size; ++i) {
+            array[i] = element_t(value_gen(rng));
+        }
+    }
+};
+
+// Values 0, 1, ..., n_values - 1, where value v has the probability proportional to 1 / (v + 1)^exponent
+template<typename element_t, typename rng_t>
+struct zipf_generator : sequence_changer<element_t> {
+    rng_t &rng;
+    std::vector<double> cdf;
+
+    zipf_generator(rng_t &rng, size_t n_values, double exponent): rng(rng), cdf(n_values) {
+        double sum = 0;
+        for (size_t v = 0; v < n_values; ++v) {
+            sum += std::pow(double(v + 1), -exponent);
+            cdf[v] = sum;
+        }
+        for (double &c : cdf) {
+            c /= sum;
+        }
+    }
+
+    void generate(element_t *array, size_t size) {
+        std::uniform_real_distribution<double> probability_gen(0, 1);
+        for (size_t i = 0; i < size; ++i) {
+            size_t v = std::lower_bound(cdf.begin(), cdf.end(), probability_gen(rng)) - cdf.begin();
+            array[i] = element_t(std::min(v, cdf.size() - 1));
+        }
+    }
+};
+
+// Rearranges the values so that they first increase and then decrease, like organ pipes
+template<typename element_t>
+struct organ_pipe : sequence_changer<element_t> {
+    std::vector<element_t> sorted;
+
+    void generate(element_t *array, size_t size) {
+        sorted.assign(array, array + size);
+        std::sort(sorted.begin(), sorted.end());
+        for (size_t i = 0, left = 0, right = size; i < size; ++i) {
+            if (i % 2 == 0) {
+                array[left++] = sorted[i];
+            } else {
+                array[--right] = sorted[i];
+            }
+        }
+    }
+};
+
+// Sorts every of the n_teeth consecutive parts of the array, making a sawtooth
+template<typename element_t>
+struct sawtooth : sequence_changer<element_t> {
+    size_t n_teeth;
+
+    sawtooth(size_t n_teeth): n_teeth(n_teeth) {}
+
+    void generate(element_t *array, size_t size) {
+        for (size_t t = 0; t < n_teeth; ++t) {
+            std::sort(array + size * t / n_teeth, array + size * (t + 1) / n_teeth);
+        }
+    }
+};
+
+// Makes percent * size / 100 swaps of random pairs of elements, e.g. to make a sorted array nearly sorted
+template<typename element_t, typename rng_t>
+struct random_swapper : sequence_changer<element_t> {
+    rng_t &rng;
+    double percent;
+
+    random_swapper(rng_t &rng, double percent): rng(rng), percent(percent) {}
+
+    void generate(element_t *array, size_t size) {
+        std::uniform_int_distribution<size_t> pos_gen(0, size - 1);
+        for (size_t i = 0, n_swaps = size_t(size * percent / 100); i < n_swaps; ++i) {
+            std::swap(array[pos_gen(rng)], array[pos_gen(rng)]);
+        }
+    }
+};
+
+/*
+ * A periodic pattern whose period is the phase-1 sampling stride of predicting_kth_statistic
+ * with the given sample sizes: the value at i is (i mod stride) * scale plus a random value in [0, scale).
+ * All the samples then have the same i mod stride, so they represent only a thin layer of the values,
+ * and the predicted band misses k unless k happens to be in this layer.
+ */
+template<typename element_t, typename rng_t>
+struct stride_periodic_generator : sequence_changer<element_t> {
+    rng_t &rng;
+    sample_sizes &sizes;
+    element_t scale;
+
+    stride_periodic_generator(rng_t &rng, sample_sizes &sizes, element_t scale): rng(rng), sizes(sizes), scale(scale) {}
+
+    void generate(element_t *array, size_t size) {
+        size_t stride = sizes.is_size_acceptable(size) ? size / sizes.n_phase_1_samples(size) : 1;
+        typedef std::conditional_t<std::is_integral_v<element_t>,
+                                   std::uniform_int_distribution<element_t>,
+                                   std::uniform_real_distribution<element_t> > distribution_t;
+        distribution_t value_gen(0, std::is_integral_v<element_t> ? scale - 1 : scale);
+        for (size_t i = 0; i < size; ++i) {
+            array[i] = element_t(i % stride) * scale + value_gen(rng);
+        }
+    }
+};
+
+/*
+ * An input on which bidirectional_hoare_middle takes quadratic time to find the k-th element, k = size / divisor.
+ *
+ * Its pivot is the middle element of the current range. If this pivot is the minimum of the range,
+ * the partitioning loop swaps it with the first element of the range, scans the whole range,
+ * and only excludes this first element. This is simulated by tracking which original position
+ * is at every position, and the pivots get the values 0, 1, ..., k - 1 in the order they are used,
+ * so it takes k scans to get to k. The other positions get the larger values in order.
+ */
+template<typename element_t>
+struct hoare_middle_killer : sequence_changer<element_t> {
+    size_t divisor;
+    std::vector<size_t> origin;
+
+    hoare_middle_killer(size_t divisor): divisor(divisor) {}
+
+    void generate(element_t *array, size_t size) {
+        static constexpr size_t unassigned = size_t(-1);
+        size_t k = size / divisor;
+        origin.resize(size);
+        std::vector<size_t> values(size, unassigned);
+        for (size_t i = 0; i < size; ++i) {
+            origin[i] = i;
+        }
+        for (size_t from = 0; from < k; ++from) {
+            size_t middle = from + (size - 1 - from) / 2;
+            values[origin[middle]] = from;
+            std::swap(origin[from], origin[middle]);
+        }
+        for (size_t i = 0, next = k; i < size; ++i) {
+            array[i] = element_t(values[i] == unassigned ? next++ : values[i]);
+        }
+    }
+};
+
+/*
+ * Real data: the arrays are consecutive parts of a binary file of raw elements in the native byte order,
+ * wrapping around to the beginning of the file if it is too short.
+ */
+template<typename element_t>
+struct file_replayer : sequence_changer<element_t> {
+    std::vector<element_t> data;
+    size_t position;
+
+    file_replayer(char const *path): position(0) {
+        std::ifstream in(path, std::ios::binary);
+        in.seekg(0, std::ios::end);
+        std::streamoff bytes = in ? std::streamoff(in.tellg()) : 0;
+        in.seekg(0, std::ios::beg);
+        data.resize(size_t(bytes) / sizeof(element_t));
+        in.read(reinterpret_cast<char *>(data.data()), std::streamsize(data.size() * sizeof(element_t)));
+        if (!in || data.empty()) {
+            std::cerr << "Error: cannot read elements of size " << sizeof(element_t) << " from " << path << std::endl;
+            std::exit(1);
+        }
+    }
+
+    void generate(element_t *array, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            array[i] = data[position];
+            position = position + 1 == data.size() ? 0 : position + 1;
+        }
+    }
+};
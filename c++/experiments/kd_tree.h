@@ -0,0 +1,157 @@
+#pragma once
+
+/*
+ * A balanced k-d tree, built by recursive median splits through the kth_statistic interface:
+ * the multidimensional divide-and-conquer which the README gives as the motivation for this project.
+ *
+ * The points are n rows of d coordinates. The tree is implicit, as the order of the point indices:
+ * the node of a range [from, to) of this order is its median position, middle = from + (to - from) / 2,
+ * its split dimension is its depth modulo d, the points of [from, middle) have the coordinate
+ * not greater than that of the median point, and the points of (middle, to) not smaller.
+ * The ranges of at most leaf_size points are the leaves, which are in no particular order.
+ *
+ * Every split gathers the coordinates of its range into a key column, and the engine finds the median
+ * on a copy of it, which it may permute or destroy. Then a single pass over the key column splits the indices
+ * into the other of two index buffers, so that the levels take turns in them. The indices of the keys equal
+ * to the median go in between, hence the median point lands at the middle whatever the ties are.
+ * All these buffers are taken from one workspace at the start of the build, and every range
+ * uses the same positions of them at every level, so nothing is allocated during the recursion.
+ * This workspace must not be the one of the engine, which would overwrite them.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+#include "kth_statistic.h"
+#include "workspace.h"
+
+template<typename coord_t>
+class kd_tree_builder {
+    kth_statistic<coord_t> &_engine;
+    size_t _leaf_size;
+    workspace *_workspace;
+    bool _owns_workspace;
+    size_t _builds, _splits;
+
+    // the current build
+    coord_t const *_points;
+    size_t _dims;
+    size_t *_order[2];
+    coord_t *_keys, *_copy;
+    size_t *_result;
+
+    void build(size_t from, size_t to, size_t depth) {
+        size_t *order = _order[depth % 2];
+        if (to - from <= _leaf_size) {
+            std::copy(order + from, order + to, _result + from);
+            return;
+        }
+        ++_splits;
+        size_t size = to - from, k = size / 2, dim = depth % _dims;
+        for (size_t i = from; i < to; ++i) {
+            _keys[i] = _points[order[i] * _dims + dim];
+        }
+        std::copy(_keys + from, _keys + to, _copy + from);
+        coord_t median = _engine.find(_copy + from, size, k);
+
+        // the smaller keys go to the front, the greater ones to the back, and the equal ones
+        // are compacted within the current order, behind the position which is read
+        size_t *next = _order[(depth + 1) % 2];
+        size_t lo = from, hi = to, n_equal = 0;
+        for (size_t i = from; i < to; ++i) {
+            coord_t key = _keys[i];
+            size_t index = order[i];
+            bool less = key < median, greater = median < key;
+            next[lo] = index;
+            lo += less;
+            next[hi - 1] = index;
+            hi -= greater;
+            order[from + n_equal] = index;
+            n_equal += !less & !greater;
+        }
+        std::copy(order + from, order + from + n_equal, next + lo);
+
+        size_t middle = from + k;
+        _result[middle] = next[middle];
+        build(from, middle, depth + 1);
+        build(middle + 1, to, depth + 1);
+    }
+
+public:
+    kd_tree_builder(kth_statistic<coord_t> &engine, size_t leaf_size = 8, workspace *shared_workspace = nullptr)
+    : _engine(engine), _leaf_size(std::max<size_t>(1, leaf_size)),
+      _workspace(shared_workspace != nullptr ? shared_workspace : new workspace()),
+      _owns_workspace(shared_workspace == nullptr),
+      _builds(0), _splits(0) {}
+
+    ~kd_tree_builder() {
+        if (_owns_workspace) {
+            delete _workspace;
+        }
+    }
+
+    char const *name() const { return _engine.name(); }
+    size_t leaf_size() const { return _leaf_size; }
+
+    // Writes the order of the point indices which makes the tree to result[0], ..., result[n - 1]
+    void build(coord_t const *points, size_t n, size_t dims, size_t *result) {
+        ++_builds;
+        // both types are at most 8 bytes and all are powers of two, so every buffer stays aligned
+        char *mem = _workspace->get<char>(2 * n * (sizeof(size_t) + sizeof(coord_t)));
+        _order[0] = reinterpret_cast<size_t *>(mem);
+        _order[1] = _order[0] + n;
+        _keys = reinterpret_cast<coord_t *>(_order[1] + n);
+        _copy = _keys + n;
+        _points = points;
+        _dims = dims;
+        _result = result;
+        std::iota(_order[0], _order[0] + n, size_t(0));
+        if (_engine.size() < n) {
+            _engine.resize(n);
+        }
+        build(0, n, 0);
+    }
+
+    void display_and_reset_statistics(std::ostream &out) {
+        out << "    [Builds: " << _builds
+            << ", median splits: " << _splits
+            << "]" << std::endl;
+        _engine.display_and_reset_statistics(out);
+        _builds = 0;
+        _splits = 0;
+    }
+};
+
+// Checks that the order is a permutation which makes a tree as kd_tree_builder describes it
+template<typename coord_t>
+bool is_kd_tree(coord_t const *points, size_t n, size_t dims, size_t leaf_size, size_t const *order) {
+    std::vector<bool> seen(n, false);
+    for (size_t i = 0; i < n; ++i) {
+        if (order[i] >= n || seen[order[i]]) {
+            return false;
+        }
+        seen[order[i]] = true;
+    }
+    auto check = [&](auto &self, size_t from, size_t to, size_t depth) -> bool {
+        if (to - from <= leaf_size) {
+            return true;
+        }
+        size_t middle = from + (to - from) / 2, dim = depth % dims;
+        coord_t median = points[order[middle] * dims + dim];
+        for (size_t i = from; i < middle; ++i) {
+            if (median < points[order[i] * dims + dim]) {
+                return false;
+            }
+        }
+        for (size_t i = middle + 1; i < to; ++i) {
+            if (points[order[i] * dims + dim] < median) {
+                return false;
+            }
+        }
+        return self(self, from, middle, depth + 1) && self(self, middle + 1, to, depth + 1);
+    };
+    return check(check, 0, n, 0);
+}
@@ -0,0 +1,153 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "generators.h"
+#include "kd_tree.h"
+#include "kth_statistic.h"
+#include "kth_statistic_stl.h"
+#include "kth_statistic_hoare.h"
+#include "kth_statistic_floyd_rivest.h"
+#include "kth_statistic_predictor_simple.h"
+#include "kth_statistic_predictor_destructive.h"
+#include "kth_statistic_radix.h"
+
+/*
+ * The total time to build a balanced k-d tree with each engine doing the median splits,
+ * which is what the engines are for, rather than a single call on a fresh array: here most calls are on
+ * the small ranges deep in the recursion, and every range comes from a gather of one coordinate.
+ */
+template<typename coord_t>
+void measure(char const *measurement_name, size_t n, size_t dims,
+             std::vector< sequence_changer<coord_t>* > const &seq_changers,
+             std::vector< kd_tree_builder<coord_t>* > const &builders) {
+    std::cout << "Measurement '" << measurement_name
+              << "', points = " << n
+              << ", dimensions = " << dims
+              << ":" << std::endl;
+
+    size_t algo_width = 0;
+    for (auto builder : builders) {
+        algo_width = std::max(algo_width, strlen(builder->name()));
+    }
+
+    std::vector<coord_t> points(n * dims);
+    for (auto seq_changer : seq_changers) {
+        seq_changer->generate(points.data(), points.size());
+    }
+    std::vector<size_t> order(n);
+
+    for (kd_tree_builder<coord_t> *builder : builders) {
+        const auto start = std::chrono::high_resolution_clock::now();
+        builder->build(points.data(), n, dims, order.data());
+        const auto finish = std::chrono::high_resolution_clock::now();
+        if (!is_kd_tree(points.data(), n, dims, builder->leaf_size(), order.data())) {
+            std::cerr << "Error: " << builder->name() << " did not build a k-d tree" << std::endl;
+            std::exit(1);
+        }
+
+        const std::chrono::duration<double> elapsed_seconds(finish - start);
+        const std::chrono::duration<double> normalized = elapsed_seconds / double(n);
+
+        std::cout << "    " << std::setw(algo_width) << builder->name()
+                  << ": " << std::setprecision(4) << std::scientific << elapsed_seconds
+                  << ", " << std::setprecision(4) << std::scientific << normalized
+                  << " per point" << std::endl;
+        builder->display_and_reset_statistics(std::cout);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    double max_points = 1e7;
+    if (argc > 2 || (argc == 2 && (max_points = std::atof(argv[1])) < 1e5)) {
+        std::cerr << "Usage: " << argv[0] << " [<max points, at least 1e5; default 1e7, up to 1e8 if memory allows>]" << std::endl;
+        std::exit(1);
+    }
+    std::mt19937_64 rng(12314342342342LL);
+
+    tuned_ratio_sample_sizes tss;
+    tuned_ratio_policy trp;
+
+    stl_kth_statistic<int> stl_int;
+    introspective_hoare<int> intro_int;
+    floyd_rivest_kth_statistic<int> floyd_rivest_int;
+    floyd_rivest_aux_kth_statistic<int> floyd_rivest_aux_int;
+    predicting_kth_statistic<int> predicting_int_tuned(tss, "simple predicting kth, tuned");
+    predicting_kth_statistic<int, tuned_ratio_policy> predicting_int_policy(trp, "simple predicting kth, tuned policy");
+    destructive_predicting_kth_statistic<int> destructive_int_tuned(tss, "destructive predicting kth, tuned");
+    predicting_kth_statistic<int> recursive_int_tuned(tss, "recursive predicting kth, tuned, depth 2", 1, 2);
+    radix_kth_statistic<int, 11> radix_int_11("radix select, 11-bit digits");
+
+    stl_kth_statistic<double> stl_dbl;
+    introspective_hoare<double> intro_dbl;
+    floyd_rivest_kth_statistic<double> floyd_rivest_dbl;
+    floyd_rivest_aux_kth_statistic<double> floyd_rivest_aux_dbl;
+    predicting_kth_statistic<double> predicting_dbl_tuned(tss, "simple predicting kth, tuned");
+    predicting_kth_statistic<double, tuned_ratio_policy> predicting_dbl_policy(trp, "simple predicting kth, tuned policy");
+    destructive_predicting_kth_statistic<double> destructive_dbl_tuned(tss, "destructive predicting kth, tuned");
+    predicting_kth_statistic<double> recursive_dbl_tuned(tss, "recursive predicting kth, tuned, depth 2", 1, 2);
+    radix_kth_statistic<double, 11> radix_dbl_11("radix select, 11-bit digits");
+
+    // one workspace for all builders, which run one after another, and apart from those of the engines
+    workspace tree_workspace;
+    std::vector< kth_statistic<int>* > int_engines { &stl_int, &intro_int, &floyd_rivest_int, &floyd_rivest_aux_int,
+                                                     &predicting_int_tuned, &predicting_int_policy, &destructive_int_tuned,
+                                                     &recursive_int_tuned, &radix_int_11 };
+    std::vector< kth_statistic<double>* > dbl_engines { &stl_dbl, &intro_dbl, &floyd_rivest_dbl, &floyd_rivest_aux_dbl,
+                                                        &predicting_dbl_tuned, &predicting_dbl_policy, &destructive_dbl_tuned,
+                                                        &recursive_dbl_tuned, &radix_dbl_11 };
+    std::vector< std::unique_ptr< kd_tree_builder<int> > > int_owned;
+    std::vector< kd_tree_builder<int>* > int_builders;
+    for (auto engine : int_engines) {
+        int_owned.emplace_back(new kd_tree_builder<int>(*engine, 8, &tree_workspace));
+        int_builders.push_back(int_owned.back().get());
+    }
+    std::vector< std::unique_ptr< kd_tree_builder<double> > > dbl_owned;
+    std::vector< kd_tree_builder<double>* > dbl_builders;
+    for (auto engine : dbl_engines) {
+        dbl_owned.emplace_back(new kd_tree_builder<double>(*engine, 8, &tree_workspace));
+        dbl_builders.push_back(dbl_owned.back().get());
+    }
+
+    uniform_int_generator<int, std::mt19937_64> gen_int_1(rng, -1000000000, +1000000000);
+    uniform_real_generator<double, std::mt19937_64> gen_dbl_1(rng, -1.0, +1.0);
+    zipf_generator<int, std::mt19937_64> gen_int_zipf(rng, 10000, 1.1);
+    zipf_generator<double, std::mt19937_64> gen_dbl_zipf(rng, 10000, 1.1);
+
+    std::vector< std::pair< char const *, std::vector< sequence_changer<int>* > > > int_tests = {
+        { "UniformInt[-1e9, +1e9]", { &gen_int_1 } },
+        { "ZipfInt[1e4, 1.1]", { &gen_int_zipf } }
+    };
+    std::vector< std::pair< char const *, std::vector< sequence_changer<double>* > > > dbl_tests = {
+        { "UniformDouble[-1, +1]", { &gen_dbl_1 } },
+        { "ZipfDouble[1e4, 1.1]", { &gen_dbl_zipf } }
+    };
+
+    size_t dimensions[] = { 2, 3, 5, 8 };
+
+    std::cout << "********* Int, k-d tree build **********\n" << std::endl;
+    for (auto config : int_tests) {
+        for (size_t dims : dimensions) {
+            for (double n = 1e5; n <= max_points; n *= 10) {
+                measure(config.first, size_t(n), dims, config.second, int_builders);
+            }
+            std::cout << std::endl;
+        }
+    }
+
+    std::cout << "********* Double, k-d tree build **********\n" << std::endl;
+    for (auto config : dbl_tests) {
+        for (size_t dims : dimensions) {
+            for (double n = 1e5; n <= max_points; n *= 10) {
+                measure(config.first, size_t(n), dims, config.second, dbl_builders);
+            }
+            std::cout << std::endl;
+        }
+    }
+    return 0;
+}
@@ -4,6 +4,7 @@
 #include <iostream>
 #include <limits>
 #include <utility>
+#include <vector>
 
 /*
  * A k-th order statistic of a sequence of elements with a total ordering
@@ -27,6 +28,39 @@
  * Use this at your own risk.
  */
 
+/*
+ * Rearranges the elements in [start, start + size) such that, for each k in the sorted range [ks_begin, ks_end),
+ * start[k] is the element which would be there if the array was sorted,
+ * and the array is partitioned around it, just as std::nth_element does for a single k.
+ *
+ * This is done by recursive partitioning: std::nth_element is called for the middle k,
+ * and the remaining values of k are processed in the left and the right parts independently.
+ */
+template<typename element_t>
+void multi_nth_element(element_t *start, size_t from, size_t until, size_t const *ks_begin, size_t const *ks_end) {
+    while (ks_begin != ks_end) {
+        size_t const *ks_mid = ks_begin + (ks_end - ks_begin) / 2;
+        size_t k = *ks_mid;
+        std::nth_element(start + from, start + k, start + until);
+        multi_nth_element(start, from, k, ks_begin, std::lower_bound(ks_begin, ks_mid, k));
+        from = k + 1;
+        ks_begin = std::upper_bound(ks_mid, ks_end, k);
+    }
+}
+
+template<typename element_t>
+void multi_nth_element(element_t *start, size_t size, size_t const *ks_begin, size_t const *ks_end) {
+    multi_nth_element(start, 0, size, ks_begin, ks_end);
+}
+
+// Sorts the values of k and removes the duplicates, as required by the multi-k algorithms.
+inline std::vector<size_t> sorted_unique_ks(size_t const *ks, size_t n_ks) {
+    std::vector<size_t> result(ks, ks + n_ks);
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
 template<typename element_t>
 struct kth_statistic {
     virtual char const *name() const = 0;
@@ -35,6 +69,44 @@ struct kth_statistic {
     virtual size_t size() = 0;
     virtual void resize(size_t new_size) = 0;
     virtual element_t find(element_t *start, size_t size, size_t k) = 0;
+
+    /*
+     * Finds the ks[i]-th order statistic for every i < n_ks and writes it to out[i].
+     * The values of k may come in any order and may repeat.
+     *
+     * The default implementation uses recursive partitioning with std::nth_element.
+     */
+    virtual void find_many(element_t *start, size_t size, size_t const *ks, size_t n_ks, element_t *out) {
+        std::vector<size_t> sorted_ks = sorted_unique_ks(ks, n_ks);
+        multi_nth_element(start, size, sorted_ks.data(), sorted_ks.data() + sorted_ks.size());
+        for (size_t i = 0; i < n_ks; ++i) {
+            out[i] = start[ks[i]];
+        }
+    }
+
+    /*
+     * Rearranges the elements as std::nth_element does: start[k] becomes the k-th order statistic,
+     * no element before it is greater, and no element after it is less.
+     * Unlike find(), this is guaranteed for every algorithm, including the ones which work on aux memory.
+     *
+     * The default implementation uses std::nth_element.
+     */
+    virtual void partition_at(element_t *start, size_t size, size_t k) {
+        std::nth_element(start, start + k, start + size);
+    }
+
+    /*
+     * Finds the k-th order statistic of each of the n_arrays arrays starts[i], ..., starts[i] + size - 1,
+     * all of the same size, and writes it to out[i]. The arrays are left as find() leaves them.
+     *
+     * The default implementation calls find() for every array.
+     */
+    virtual void find_batch(element_t *const *starts, size_t n_arrays, size_t size, size_t k, element_t *out) {
+        for (size_t i = 0; i < n_arrays; ++i) {
+            out[i] = find(starts[i], size, k);
+        }
+    }
+
     virtual void display_and_reset_statistics(std::ostream &out) {};
     virtual ~kth_statistic() {}
 };
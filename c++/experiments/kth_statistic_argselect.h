@@ -0,0 +1,101 @@
+#pragma once
+
+/*
+ * Argselect: finding where the k-th element is, rather than what it is.
+ *
+ * The keys are given as a separate column, which is never modified,
+ * and the result is the index of the k-th smallest key in this column
+ * (if there are several keys equal to it, the index of any of them may be returned).
+ *
+ * This allows selecting records by one of their fields without moving the records:
+ * - for a structure of arrays, that is, a key column and a payload column (such as record indices),
+ *   find_payload returns the payload which stands next to the k-th key;
+ * - for an array of structures, find_record projects every record to its key
+ *   into a key column provided by the caller, and returns the k-th record itself.
+ */
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <limits>
+
+#include "workspace.h"
+
+// An element of the aux arrays of argselect algorithms: a key, and where it is in the key column
+template<typename key_t>
+struct keyed_index {
+    key_t key;
+    size_t index;
+
+    bool operator < (keyed_index const &that) const {
+        return key < that.key;
+    }
+};
+
+template<typename key_t>
+struct kth_argselect {
+    virtual char const *name() const = 0;
+    virtual size_t size() = 0;
+    virtual void resize(size_t new_size) = 0;
+    // Returns i such that keys[i] is the k-th order statistic of keys[0], ..., keys[size - 1]
+    virtual size_t find_index(key_t const *keys, size_t size, size_t k) = 0;
+
+    template<typename payload_t>
+    payload_t const &find_payload(key_t const *keys, payload_t const *payloads, size_t size, size_t k) {
+        return payloads[find_index(keys, size, k)];
+    }
+
+    // The projection is anything std::invoke accepts, e.g. a pointer to the key field of record_t
+    template<typename record_t, typename projection_t>
+    record_t const &find_record(record_t const *records, size_t size, size_t k,
+                                projection_t projection, key_t *key_column) {
+        for (size_t i = 0; i < size; ++i) {
+            key_column[i] = std::invoke(projection, records[i]);
+        }
+        return records[find_index(key_column, size, k)];
+    }
+
+    virtual void display_and_reset_statistics(std::ostream &out) {};
+    virtual ~kth_argselect() {}
+};
+
+// The baseline: std::nth_element on (key, index) pairs of the whole array
+template<typename key_t>
+struct stl_argselect : kth_argselect<key_t> {
+private:
+    size_t _size;
+    workspace *_workspace;
+    bool _owns_workspace;
+    keyed_index<key_t> *_mem;
+
+public:
+    char const *name() const { return "std::nth_element on (key, index)"; }
+    size_t size() { return _size; }
+
+    stl_argselect(size_t initial_size = 1, workspace *shared_workspace = nullptr)
+    : _size(initial_size),
+      _workspace(shared_workspace != nullptr ? shared_workspace : new workspace()),
+      _owns_workspace(shared_workspace == nullptr) {
+        _mem = _workspace->get< keyed_index<key_t> >(_size);
+    }
+
+    void resize(size_t new_size) {
+        _size = new_size;
+        _mem = _workspace->get< keyed_index<key_t> >(_size);
+    }
+
+    ~stl_argselect() {
+        if (_owns_workspace) {
+            delete _workspace;
+        }
+    }
+
+    size_t find_index(key_t const *keys, size_t size, size_t k) {
+        _mem = _workspace->get< keyed_index<key_t> >(size);
+        for (size_t i = 0; i < size; ++i) {
+            _mem[i] = { keys[i], i };
+        }
+        std::nth_element(_mem, _mem + k, _mem + size);
+        return _mem[k].index;
+    }
+};
@@ -0,0 +1,245 @@
+#pragma once
+
+/*
+ * Selection in batches of many small arrays of the same size, with the same k, such as the workload
+ * of performance_test: millions of arrays of 10 to 1000 elements, and one find in each of them.
+ *
+ * A single small array leaves the SIMD lanes idle: a sorting network has too few independent comparators
+ * in a layer, and the sample of a prediction is too small to fill them. So the arrays are taken
+ * in groups of one cache line of elements (16 ints or 8 doubles, an AVX-512 register), and interleaved,
+ * so that the i-th elements of all the arrays of the group make the i-th line. Then every compare-exchange
+ * of a network is a minimum and a maximum of two whole lines, done by the compare_exchange_lines kernel
+ * of kth_statistic_filters.h, which is picked at runtime like the filters, and all the arrays of the group
+ * go through the same network in lockstep, without a branch. If the batch does not fill the last group,
+ * its missing arrays repeat the last one, and their results are dropped.
+ *
+ * The network is the odd-even merge sort of kth_statistic_network.h, generated at runtime for the sizes
+ * up to max_batch_network_size, and pruned to the comparators which the outputs depend on,
+ * as the other positions need not be sorted. The network of the last call is kept for the next one.
+ * It serves two purposes:
+ * - the arrays of up to max_batch_network_size elements are interleaved as a whole, and selected by the network;
+ * - for the larger arrays, up to max_batch_size, only a strided sample of half of the array (but at most
+ *   max_batch_network_size) is interleaved, and the network, pruned for two outputs, finds the bounds of the band
+ *   around k in the samples of all the arrays of the group at once. Then every array is filtered by itself,
+ *   and k is selected in its band, as predicting_kth_statistic does. An array whose band misses k
+ *   is passed to the engine, which also does everything else, including the batches of larger arrays.
+ *
+ * Only numbers are batched, as in kth_statistic_network.h: the batches of other elements go to the engine.
+ * The interleaved arrays are copies, so the arrays are left as they were, except for the ones which are passed
+ * to the engine. The workspace must not be the one of the engine, as the engine is called
+ * while the interleaved samples are still needed.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "kth_statistic.h"
+#include "kth_statistic_filters.h"
+#include "kth_statistic_network.h"
+#include "workspace.h"
+
+// The greatest network, for which compare_exchange_lines takes the positions as bytes
+constexpr size_t max_batch_network_size = 256;
+// Beyond this, a batch gains nothing over the engine
+constexpr size_t max_batch_size = 2048;
+
+// One cache line of elements, the width of the widest vector registers
+template<typename element_t>
+constexpr size_t batch_lanes = std::max<size_t>(1, batch_line_bytes / sizeof(element_t));
+
+namespace batch_detail {
+
+// The comparators of the network for n elements which the outputs at the given positions depend on, in order,
+// as the pairs of compare_exchange_lines: going backwards, a comparator is needed if it writes to a position
+// which is needed, and then both its inputs are needed
+inline std::vector<uint8_t> pruned_network(size_t n, size_t const *outputs, size_t n_outputs) {
+    std::vector<std::pair<size_t, size_t> > network;
+    sorting_network_detail::odd_even_merge_sort(n, [&network](size_t low, size_t high) {
+        network.emplace_back(low, high);
+    });
+    std::vector<bool> needed(n, false);
+    for (size_t i = 0; i < n_outputs; ++i) {
+        needed[outputs[i]] = true;
+    }
+    std::vector<uint8_t> result;
+    for (size_t i = network.size(); i-- > 0;) {
+        auto [low, high] = network[i];
+        if (needed[low] || needed[high]) {
+            needed[low] = needed[high] = true;
+            result.push_back(uint8_t(high));
+            result.push_back(uint8_t(low));
+        }
+    }
+    std::reverse(result.begin(), result.end());
+    return result;
+}
+
+}
+
+template<typename element_t>
+struct batched_kth_statistic : kth_statistic<element_t> {
+private:
+    static constexpr size_t lanes = batch_lanes<element_t>;
+    // the band is this many standard deviations of the rank of k in the sample either way
+    static constexpr double band_deviations = 3.0;
+
+    kth_statistic<element_t> &_engine;
+    char const *_name;
+    workspace *_workspace;
+    bool _owns_workspace;
+    size_t _batches, _groups, _hits, _misses;
+
+    // the pruned network of the last call, which is usually the same for the next one
+    std::vector<uint8_t> _network;
+    size_t _network_n;
+    std::vector<size_t> _network_outputs;
+
+    // The pairs of the network for n elements pruned to the outputs
+    std::vector<uint8_t> const &network(size_t n, std::initializer_list<size_t> outputs) {
+        if (_network_n != n || !std::equal(outputs.begin(), outputs.end(), _network_outputs.begin(), _network_outputs.end())) {
+            _network_n = n;
+            _network_outputs.assign(outputs);
+            _network = batch_detail::pruned_network(n, _network_outputs.data(), _network_outputs.size());
+        }
+        return _network;
+    }
+
+    // The arrays of a group, and the last one in place of the missing ones
+    static element_t *lane_array(element_t *const *group, size_t n_group, size_t l) {
+        return group[std::min(l, n_group - 1)];
+    }
+
+    void select_by_network(element_t *const *group, size_t n_group, size_t size, size_t k, element_t *out) {
+        element_t *lines = _workspace->get<element_t>(size * lanes);
+        for (size_t l = 0; l < lanes; ++l) {
+            element_t const *arr = lane_array(group, n_group, l);
+            for (size_t i = 0; i < size; ++i) {
+                lines[i * lanes + l] = arr[i];
+            }
+        }
+        std::vector<uint8_t> const &pairs = network(size, { k });
+        filter_kernels<element_t>().compare_exchange_lines(lines, pairs.data(), pairs.size() / 2);
+        std::copy(lines + k * lanes, lines + k * lanes + n_group, out);
+    }
+
+    void select_by_sample(element_t *const *group, size_t n_group, size_t size, size_t k, element_t *out) {
+        const size_t n_samples = std::min(max_batch_network_size, size / 2);
+        const size_t proportion = size / n_samples;
+        const size_t offset_from_below = (size - (n_samples - 1) * proportion + 1) / 2;
+
+        // the band around the expected rank of k in the sample, where a bound past the sample is not checked
+        const double p = (double(k) + 0.5) / double(size);
+        const double expected = p * double(n_samples) - 0.5;
+        const double deviation = band_deviations * std::sqrt(double(n_samples) * p * (1 - p)) + 1;
+        const bool has_lower = expected - deviation >= 0;
+        const bool has_upper = expected + deviation <= double(n_samples - 1);
+        const size_t lower_idx = has_lower ? size_t(expected - deviation) : 0;
+        const size_t upper_idx = has_upper ? size_t(std::ceil(expected + deviation)) : n_samples - 1;
+
+        element_t *samples = _workspace->get<element_t>(n_samples * lanes + size);
+        element_t *band = samples + n_samples * lanes;
+        for (size_t l = 0; l < lanes; ++l) {
+            element_t const *arr = lane_array(group, n_group, l);
+            for (size_t i = 0, j = offset_from_below; i < n_samples; ++i, j += proportion) {
+                samples[i * lanes + l] = arr[j];
+            }
+        }
+        filter_kernel_set<element_t> const &filters = filter_kernels<element_t>();
+        std::vector<uint8_t> const &pairs = network(n_samples, { lower_idx, upper_idx });
+        filters.compare_exchange_lines(samples, pairs.data(), pairs.size() / 2);
+
+        for (size_t l = 0; l < n_group; ++l) {
+            element_t *arr = group[l];
+            element_t lower = samples[lower_idx * lanes + l], upper = samples[upper_idx * lanes + l];
+            element_t *band_end;
+            size_t n_less = 0;
+            if (has_lower && has_upper) {
+                band_end = filters.between(arr, arr + size, lower, upper, band, n_less);
+            } else if (has_upper) {
+                band_end = filters.not_greater(arr, arr + size, upper, band);
+            } else if (has_lower) {
+                band_end = filters.not_less(arr, arr + size, lower, band);
+                n_less = size - size_t(band_end - band);
+            } else {
+                band_end = std::copy(arr, arr + size, band);
+            }
+            if (n_less <= k && k - n_less < size_t(band_end - band)) {
+                ++_hits;
+                element_t *band_k = band + (k - n_less);
+                nth_element_or_network(band, band_k, band_end);
+                out[l] = *band_k;
+            } else {
+                ++_misses;
+                out[l] = _engine.find(arr, size, k);
+            }
+        }
+    }
+
+public:
+    batched_kth_statistic(kth_statistic<element_t> &engine, char const *name, workspace *shared_workspace = nullptr)
+    : _engine(engine), _name(name),
+      _workspace(shared_workspace != nullptr ? shared_workspace : new workspace()),
+      _owns_workspace(shared_workspace == nullptr),
+      _batches(0), _groups(0), _hits(0), _misses(0),
+      _network_n(0) {}
+
+    ~batched_kth_statistic() {
+        if (_owns_workspace) {
+            delete _workspace;
+        }
+    }
+
+    char const *name() const { return _name; }
+    bool is_inplace() const { return _engine.is_inplace(); }
+    bool is_destructive() const { return _engine.is_destructive(); }
+    size_t size() { return _engine.size(); }
+    void resize(size_t new_size) { _engine.resize(new_size); }
+
+    element_t find(element_t *start, size_t size, size_t k) {
+        return _engine.find(start, size, k);
+    }
+
+    void find_many(element_t *start, size_t size, size_t const *ks, size_t n_ks, element_t *out) {
+        _engine.find_many(start, size, ks, n_ks, out);
+    }
+
+    void partition_at(element_t *start, size_t size, size_t k) {
+        _engine.partition_at(start, size, k);
+    }
+
+    void find_batch(element_t *const *starts, size_t n_arrays, size_t size, size_t k, element_t *out) {
+        if (!uses_networks<element_t> || size < 2 || size > max_batch_size) {
+            _engine.find_batch(starts, n_arrays, size, k, out);
+            return;
+        }
+        ++_batches;
+        for (size_t first = 0; first < n_arrays; first += lanes) {
+            ++_groups;
+            size_t n_group = std::min(lanes, n_arrays - first);
+            if (size <= max_batch_network_size) {
+                select_by_network(starts + first, n_group, size, k, out + first);
+            } else {
+                select_by_sample(starts + first, n_group, size, k, out + first);
+            }
+        }
+    }
+
+    void display_and_reset_statistics(std::ostream &out) {
+        out << "    [Batches: " << _batches
+            << ", groups of " << lanes << ": " << _groups
+            << ", band hits: " << _hits
+            << ", misses: " << _misses
+            << "]" << std::endl;
+        _engine.display_and_reset_statistics(out);
+        _batches = 0;
+        _groups = 0;
+        _hits = 0;
+        _misses = 0;
+    }
+};
@@ -0,0 +1,204 @@
+#pragma once
+
+/*
+ * A predicting engine which many threads may call at once.
+ *
+ * predicting_kth_statistic keeps the aux memory of the current call and its statistics in the instance,
+ * so an instance serves one thread at a time, and the usual way out is an instance, with a full-size workspace,
+ * for every thread and every element type. Here, the instance is a set of slots instead, each of which holds
+ * a predicting_kth_statistic with its own workspace and statistics. A call leases a free slot for its duration:
+ * it tries the home slot of its thread first, which it finds free unless two threads have the same one,
+ * then the next ones, and yields only if all of them are busy. Leasing is a single atomic exchange
+ * on the cache line of the slot, which no other thread touches while the threads keep to their home slots,
+ * so the calls do not contend, however small the arrays are.
+ *
+ * The engine of a slot is created when the slot is first leased, and its workspace grows with the arrays
+ * which it is given, so the memory is that of the slots which were actually used, each as large
+ * as the largest array of its calls rather than the largest array of all the threads.
+ *
+ * The statistics are sharded the same way: every slot counts its own calls, and the engines count their
+ * hits and misses, with no atomics. display_and_reset_statistics leases every slot in turn
+ * and adds all of them to one more engine, which is never called, and which then displays the totals.
+ * It, and resize, may be called while other threads call find.
+ *
+ * The sample sizes are copied to every engine if they are a policy, and shared by reference otherwise,
+ * so they must be safe to call from many threads, which adaptive_sample_sizes is not.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "kth_statistic.h"
+#include "kth_statistic_predictor_simple.h"
+
+template<typename element_t, sample_size_policy sizes_t = sample_sizes,
+         sampling_strategy<element_t> sampler_t = strided_sampling>
+struct concurrent_kth_statistic : kth_statistic<element_t> {
+private:
+    using engine_t = predicting_kth_statistic<element_t, sizes_t, sampler_t>;
+
+    // the slots are on separate cache lines, so that leasing one does not disturb the threads which use the others
+    struct alignas(64) slot {
+        std::atomic<bool> busy;
+        std::unique_ptr<engine_t> engine;
+        size_t leases, away_leases;
+    };
+
+    char const *_name;
+    sizes_t &_sample_sizes;
+    sampler_t _sampler;
+    size_t _recursion_depth;
+    std::atomic<size_t> _size;
+    size_t _n_slots;
+    std::unique_ptr<slot[]> _slots;
+    // receives the statistics of all the slots, and is never called otherwise
+    engine_t _totals;
+    std::mutex _totals_mutex;
+
+    // The threads are numbered in the order of their first calls, and the home slot is the number modulo the slots;
+    // not a hash of std::thread::id, which is an address aligned to a large power of two on common platforms
+    static size_t thread_index() {
+        static std::atomic<size_t> n_threads(0);
+        thread_local size_t index = n_threads.fetch_add(1, std::memory_order_relaxed);
+        return index;
+    }
+
+    static bool try_lease(slot &s) {
+        return !s.busy.load(std::memory_order_relaxed) && !s.busy.exchange(true, std::memory_order_acquire);
+    }
+
+    static void wait_for(slot &s) {
+        while (!try_lease(s)) {
+            std::this_thread::yield();
+        }
+    }
+
+    static void release(slot &s) {
+        s.busy.store(false, std::memory_order_release);
+    }
+
+    // Leases a free slot, preferably the home slot of the calling thread, and makes sure it has an engine
+    slot &lease() {
+        size_t home = thread_index() % _n_slots;
+        while (true) {
+            for (size_t i = 0; i < _n_slots; ++i) {
+                slot &s = _slots[(home + i) % _n_slots];
+                if (try_lease(s)) {
+                    if (s.engine == nullptr) {
+                        s.engine = std::make_unique<engine_t>(_sample_sizes, _name, _size.load(std::memory_order_relaxed),
+                                                              _recursion_depth, nullptr, _sampler);
+                    }
+                    ++s.leases;
+                    s.away_leases += i != 0;
+                    return s;
+                }
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    // Runs f on the engine of a leased slot
+    template<typename function_t>
+    auto with_engine(function_t f) {
+        slot &s = lease();
+        struct releaser {
+            slot &s;
+            ~releaser() { release(s); }
+        } guard { s };
+        return f(*s.engine);
+    }
+
+public:
+    // Without a number of slots, there are two for every hardware thread, so that the threads seldom share a home slot
+    concurrent_kth_statistic(sizes_t &sample_sizes,
+                             char const *name,
+                             size_t initial_size = 1,
+                             size_t recursion_depth = 0,
+                             size_t n_slots = 0,
+                             sampler_t const &sampler = sampler_t())
+    : _name(name), _sample_sizes(sample_sizes), _sampler(sampler), _recursion_depth(recursion_depth),
+      _size(initial_size),
+      _n_slots(n_slots != 0 ? n_slots : 2 * std::max(1u, std::thread::hardware_concurrency())),
+      _slots(new slot[_n_slots]),
+      _totals(sample_sizes, name, 1, recursion_depth, nullptr, sampler) {
+        for (size_t i = 0; i < _n_slots; ++i) {
+            _slots[i].busy.store(false, std::memory_order_relaxed);
+            _slots[i].leases = 0;
+            _slots[i].away_leases = 0;
+        }
+    }
+
+    char const *name() const { return _name; }
+    bool is_inplace() const { return false; }
+    bool is_destructive() const { return false; }
+    size_t size() { return _size.load(std::memory_order_relaxed); }
+    size_t n_slots() const { return _n_slots; }
+
+    // The calls since the statistics were last reset, over all the slots
+    size_t leases() {
+        size_t total = 0;
+        for (size_t i = 0; i < _n_slots; ++i) {
+            wait_for(_slots[i]);
+            total += _slots[i].leases;
+            release(_slots[i]);
+        }
+        return total;
+    }
+
+    // The engines which exist are resized now, and the ones created later start with this size
+    void resize(size_t new_size) {
+        _size.store(new_size, std::memory_order_relaxed);
+        for (size_t i = 0; i < _n_slots; ++i) {
+            wait_for(_slots[i]);
+            if (_slots[i].engine != nullptr) {
+                _slots[i].engine->resize(new_size);
+            }
+            release(_slots[i]);
+        }
+    }
+
+    element_t find(element_t *start, size_t size, size_t k) {
+        return with_engine([=](engine_t &engine) { return engine.find(start, size, k); });
+    }
+
+    void find_many(element_t *start, size_t size, size_t const *ks, size_t n_ks, element_t *out) {
+        with_engine([=](engine_t &engine) { engine.find_many(start, size, ks, n_ks, out); });
+    }
+
+    void partition_at(element_t *start, size_t size, size_t k) {
+        with_engine([=](engine_t &engine) { engine.partition_at(start, size, k); });
+    }
+
+    // The whole batch goes to one engine, as a batch is a unit of work of one thread
+    void find_batch(element_t *const *starts, size_t n_arrays, size_t size, size_t k, element_t *out) {
+        with_engine([=](engine_t &engine) { engine.find_batch(starts, n_arrays, size, k, out); });
+    }
+
+    void display_and_reset_statistics(std::ostream &out) {
+        std::lock_guard<std::mutex> lock(_totals_mutex);
+        size_t n_engines = 0, leases = 0, away_leases = 0;
+        for (size_t i = 0; i < _n_slots; ++i) {
+            slot &s = _slots[i];
+            wait_for(s);
+            if (s.engine != nullptr) {
+                ++n_engines;
+                s.engine->add_statistics_to(_totals);
+            }
+            leases += std::exchange(s.leases, 0);
+            away_leases += std::exchange(s.away_leases, 0);
+            release(s);
+        }
+        out << "    [Slots: " << _n_slots
+            << ", engines: " << n_engines
+            << ", leases: " << leases
+            << ", away from the home slot: " << away_leases
+            << "]" << std::endl;
+        _totals.display_and_reset_statistics(out);
+    }
+};
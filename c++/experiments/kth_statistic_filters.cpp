@@ -0,0 +1,54 @@
+#include "kth_statistic_filters.h"
+#include "kth_statistic_filters_simd.h"
+
+char const *filter_isa_name(filter_isa isa) {
+    switch (isa) {
+        case filter_isa::avx512: return "AVX-512";
+        case filter_isa::avx2: return "AVX2";
+        default: return "scalar";
+    }
+}
+
+filter_isa detected_filter_isa() {
+    static const filter_isa isa = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            return filter_isa::avx512;
+        }
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+            return filter_isa::avx2;
+        }
+        return filter_isa::scalar;
+    }();
+    return isa;
+}
+
+template<typename element_t>
+static filter_kernel_set<element_t> const &pick_filter_kernels() {
+    static constexpr filter_kernel_set<element_t> scalar = scalar_filter_kernels<element_t>();
+    switch (detected_filter_isa()) {
+        case filter_isa::avx512: return avx512_filter_kernels<element_t>();
+        case filter_isa::avx2: return avx2_filter_kernels<element_t>();
+        default: return scalar;
+    }
+}
+
+template<> filter_kernel_set<int32_t> const &filter_kernels<int32_t>() {
+    static filter_kernel_set<int32_t> const &kernels = pick_filter_kernels<int32_t>();
+    return kernels;
+}
+
+template<> filter_kernel_set<int64_t> const &filter_kernels<int64_t>() {
+    static filter_kernel_set<int64_t> const &kernels = pick_filter_kernels<int64_t>();
+    return kernels;
+}
+
+template<> filter_kernel_set<float> const &filter_kernels<float>() {
+    static filter_kernel_set<float> const &kernels = pick_filter_kernels<float>();
+    return kernels;
+}
+
+template<> filter_kernel_set<double> const &filter_kernels<double>() {
+    static filter_kernel_set<double> const &kernels = pick_filter_kernels<double>();
+    return kernels;
+}
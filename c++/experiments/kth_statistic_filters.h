@@ -0,0 +1,157 @@
+#pragma once
+
+/*
+ * Filtering kernels used by the predicting algorithms.
+ *
+ * Each kernel makes a single pass over [from, until) and copies the elements
+ * which satisfy some condition to dest, keeping their relative order.
+ * The destination may coincide with the source, or lie before it,
+ * as elements are always written at or before the position they are read from.
+ * The kernels may write garbage past the returned end pointer,
+ * but never further than dest + (until - from).
+ *
+ * There is also the one kernel of batched_kth_statistic (see kth_statistic_batch.h), which compares
+ * lines of batch_line_bytes rather than filters, but is picked in the same way.
+ *
+ * The generic implementation is the branchless scalar loop.
+ * For int32_t, int64_t, float and double, vectorized compress-store versions
+ * (AVX2 and AVX-512) are picked at runtime depending on what the CPU supports.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+// The interleaved lines of compare_exchange_lines: a cache line, and the widest vector register
+constexpr size_t batch_line_bytes = 64;
+
+enum class filter_isa { scalar, avx2, avx512 };
+
+char const *filter_isa_name(filter_isa isa);
+
+// The best instruction set supported by both the CPU and the build.
+filter_isa detected_filter_isa();
+
+template<typename element_t>
+struct filter_kernel_set {
+    // copies elements x such that x <= upper, returns the new end of dest
+    element_t *(*not_greater)(element_t const *from, element_t const *until, element_t upper, element_t *dest);
+    // copies elements x such that x >= lower, returns the new end of dest
+    element_t *(*not_less)(element_t const *from, element_t const *until, element_t lower, element_t *dest);
+    // copies elements x such that lower <= x <= upper, returns the new end of dest,
+    // and adds the number of elements x < lower to n_less
+    element_t *(*between)(element_t const *from, element_t const *until, element_t lower, element_t upper,
+                          element_t *dest, size_t &n_less);
+    // adds the number of elements x < value to n_less, and x == value to n_equal
+    void (*count_less_equal)(element_t const *from, element_t const *until, element_t value,
+                             size_t &n_less, size_t &n_equal);
+    // bounds[0] <= bounds[1] <= ... <= bounds[n_bounds - 1] alternately open and close bands,
+    // the first one being a closing one if inside_initially is true;
+    // x passes an opening bound b if x >= b, and a closing bound b if x > b.
+    // Copies elements x which are inside some band, returns the new end of dest,
+    // and adds the number of elements which passed bounds[i] to n_passed[i].
+    element_t *(*bands)(element_t const *from, element_t const *until,
+                        element_t const *bounds, size_t n_bounds, bool inside_initially,
+                        element_t *dest, size_t *n_passed);
+    // line i is the i-th run of batch_line_bytes / sizeof(element_t) elements (at least one) from lines;
+    // for every pair (pairs[2 * j], pairs[2 * j + 1]), in order, replaces these two lines by their minimum and maximum lane by lane
+    void (*compare_exchange_lines)(element_t *lines, uint8_t const *pairs, size_t n_pairs);
+};
+
+template<typename element_t>
+element_t *scalar_filter_not_greater(element_t const *from, element_t const *until, element_t upper, element_t *dest) {
+    for (element_t const *curr = from; curr < until; ++curr) {
+        *dest = *curr;
+        dest += *curr <= upper;
+    }
+    return dest;
+}
+
+template<typename element_t>
+element_t *scalar_filter_not_less(element_t const *from, element_t const *until, element_t lower, element_t *dest) {
+    for (element_t const *curr = from; curr < until; ++curr) {
+        *dest = *curr;
+        dest += *curr >= lower;
+    }
+    return dest;
+}
+
+template<typename element_t>
+element_t *scalar_filter_between(element_t const *from, element_t const *until, element_t lower, element_t upper,
+                                 element_t *dest, size_t &n_less) {
+    size_t count_less = 0;
+    for (element_t const *curr = from; curr < until; ++curr) {
+        *dest = *curr;
+        bool is_lower = *curr < lower;
+        bool is_good = !is_lower && *curr <= upper;
+        count_less += is_lower;
+        dest += is_good;
+    }
+    n_less += count_less;
+    return dest;
+}
+
+template<typename element_t>
+void scalar_count_less_equal(element_t const *from, element_t const *until, element_t value,
+                             size_t &n_less, size_t &n_equal) {
+    size_t count_less = 0;
+    size_t count_eq = 0;
+    for (element_t const *curr = from; curr < until; ++curr) {
+        count_less += *curr < value;
+        count_eq += *curr == value;
+    }
+    n_less += count_less;
+    n_equal += count_eq;
+}
+
+template<typename element_t>
+element_t *scalar_filter_bands(element_t const *from, element_t const *until,
+                               element_t const *bounds, size_t n_bounds, bool inside_initially,
+                               element_t *dest, size_t *n_passed) {
+    for (element_t const *curr = from; curr < until; ++curr) {
+        bool inside = inside_initially;
+        bool opening = !inside_initially;
+        for (size_t i = 0; i < n_bounds; ++i, opening = !opening) {
+            bool passed = opening ? *curr >= bounds[i] : *curr > bounds[i];
+            n_passed[i] += passed;
+            inside ^= passed;
+        }
+        *dest = *curr;
+        dest += inside;
+    }
+    return dest;
+}
+
+template<typename element_t>
+void scalar_compare_exchange_lines(element_t *lines, uint8_t const *pairs, size_t n_pairs) {
+    constexpr size_t line = batch_line_bytes / sizeof(element_t) > 0 ? batch_line_bytes / sizeof(element_t) : 1;
+    for (size_t j = 0; j < n_pairs; ++j) {
+        element_t *a = lines + pairs[2 * j] * line, *b = lines + pairs[2 * j + 1] * line;
+        for (size_t l = 0; l < line; ++l) {
+            element_t low = b[l] < a[l] ? b[l] : a[l];
+            b[l] = a[l] < b[l] ? b[l] : a[l];
+            a[l] = low;
+        }
+    }
+}
+
+template<typename element_t>
+constexpr filter_kernel_set<element_t> scalar_filter_kernels() {
+    return { &scalar_filter_not_greater<element_t>,
+             &scalar_filter_not_less<element_t>,
+             &scalar_filter_between<element_t>,
+             &scalar_count_less_equal<element_t>,
+             &scalar_filter_bands<element_t>,
+             &scalar_compare_exchange_lines<element_t> };
+}
+
+template<typename element_t>
+filter_kernel_set<element_t> const &filter_kernels() {
+    static constexpr filter_kernel_set<element_t> kernels = scalar_filter_kernels<element_t>();
+    return kernels;
+}
+
+// These are picked at runtime, see kth_statistic_filters.cpp
+template<> filter_kernel_set<int32_t> const &filter_kernels<int32_t>();
+template<> filter_kernel_set<int64_t> const &filter_kernels<int64_t>();
+template<> filter_kernel_set<float> const &filter_kernels<float>();
+template<> filter_kernel_set<double> const &filter_kernels<double>();
@@ -0,0 +1,163 @@
+/*
+ * AVX2 versions of the filtering kernels.
+ *
+ * AVX2 has no compress instruction, so the selected lanes are moved to the front
+ * with a permutation taken from a table indexed by the lane mask,
+ * and then the whole vector is stored.
+ *
+ * This file must be compiled with -mavx2 -mpopcnt.
+ */
+
+#include <immintrin.h>
+
+#include "kth_statistic_filters_simd.h"
+
+struct avx2_compress_tables {
+    // 32-bit lanes: permutation of 8 lanes for each 8-bit mask
+    alignas(32) int32_t lanes_8[256][8];
+    // 64-bit lanes: permutation of 4 pairs of 32-bit lanes for each 4-bit mask
+    alignas(32) int32_t lanes_4[16][8];
+
+    constexpr avx2_compress_tables() : lanes_8(), lanes_4() {
+        for (int mask = 0; mask < 256; ++mask) {
+            int pos = 0;
+            for (int lane = 0; lane < 8; ++lane) {
+                if (mask & (1 << lane)) {
+                    lanes_8[mask][pos++] = lane;
+                }
+            }
+            while (pos < 8) {
+                lanes_8[mask][pos++] = 0;
+            }
+        }
+        for (int mask = 0; mask < 16; ++mask) {
+            int pos = 0;
+            for (int lane = 0; lane < 4; ++lane) {
+                if (mask & (1 << lane)) {
+                    lanes_4[mask][pos++] = 2 * lane;
+                    lanes_4[mask][pos++] = 2 * lane + 1;
+                }
+            }
+            while (pos < 8) {
+                lanes_4[mask][pos++] = 0;
+            }
+        }
+    }
+};
+
+static constexpr avx2_compress_tables compress_tables;
+
+static inline __m256i permutation_8(unsigned mask) {
+    return _mm256_load_si256(reinterpret_cast<__m256i const *>(compress_tables.lanes_8[mask]));
+}
+
+static inline __m256i permutation_4(unsigned mask) {
+    return _mm256_load_si256(reinterpret_cast<__m256i const *>(compress_tables.lanes_4[mask]));
+}
+
+struct avx2_ops_int32 {
+    typedef int32_t element_t;
+    typedef __m256i vec_t;
+    typedef unsigned mask_t;
+    static constexpr ptrdiff_t lanes = 8;
+
+    static vec_t load(element_t const *p) { return _mm256_loadu_si256(reinterpret_cast<__m256i const *>(p)); }
+    static void store(element_t *p, vec_t v) { _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v); }
+    static vec_t broadcast(element_t v) { return _mm256_set1_epi32(v); }
+    static mask_t bits(vec_t v) { return unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(v))); }
+    static mask_t less(vec_t a, vec_t b) { return bits(_mm256_cmpgt_epi32(b, a)); }
+    static mask_t less_equal(vec_t a, vec_t b) { return bits(_mm256_cmpgt_epi32(a, b)) ^ 0xFF; }
+    static mask_t equal(vec_t a, vec_t b) { return bits(_mm256_cmpeq_epi32(a, b)); }
+    static vec_t min(vec_t a, vec_t b) { return _mm256_min_epi32(a, b); }
+    static vec_t max(vec_t a, vec_t b) { return _mm256_max_epi32(a, b); }
+    static size_t popcount(mask_t m) { return size_t(_mm_popcnt_u32(m)); }
+    static element_t *compress_store(element_t *dest, vec_t v, mask_t m) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest), _mm256_permutevar8x32_epi32(v, permutation_8(m)));
+        return dest + popcount(m);
+    }
+};
+
+struct avx2_ops_int64 {
+    typedef int64_t element_t;
+    typedef __m256i vec_t;
+    typedef unsigned mask_t;
+    static constexpr ptrdiff_t lanes = 4;
+
+    static vec_t load(element_t const *p) { return _mm256_loadu_si256(reinterpret_cast<__m256i const *>(p)); }
+    static void store(element_t *p, vec_t v) { _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v); }
+    static vec_t broadcast(element_t v) { return _mm256_set1_epi64x(v); }
+    static mask_t bits(vec_t v) { return unsigned(_mm256_movemask_pd(_mm256_castsi256_pd(v))); }
+    static mask_t less(vec_t a, vec_t b) { return bits(_mm256_cmpgt_epi64(b, a)); }
+    static mask_t less_equal(vec_t a, vec_t b) { return bits(_mm256_cmpgt_epi64(a, b)) ^ 0xF; }
+    static mask_t equal(vec_t a, vec_t b) { return bits(_mm256_cmpeq_epi64(a, b)); }
+    static vec_t min(vec_t a, vec_t b) { return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b)); }
+    static vec_t max(vec_t a, vec_t b) { return _mm256_blendv_epi8(b, a, _mm256_cmpgt_epi64(a, b)); }
+    static size_t popcount(mask_t m) { return size_t(_mm_popcnt_u32(m)); }
+    static element_t *compress_store(element_t *dest, vec_t v, mask_t m) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest), _mm256_permutevar8x32_epi32(v, permutation_4(m)));
+        return dest + popcount(m);
+    }
+};
+
+struct avx2_ops_float {
+    typedef float element_t;
+    typedef __m256 vec_t;
+    typedef unsigned mask_t;
+    static constexpr ptrdiff_t lanes = 8;
+
+    static vec_t load(element_t const *p) { return _mm256_loadu_ps(p); }
+    static void store(element_t *p, vec_t v) { _mm256_storeu_ps(p, v); }
+    static vec_t broadcast(element_t v) { return _mm256_set1_ps(v); }
+    static mask_t less(vec_t a, vec_t b) { return unsigned(_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LT_OQ))); }
+    static mask_t less_equal(vec_t a, vec_t b) { return unsigned(_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LE_OQ))); }
+    static mask_t equal(vec_t a, vec_t b) { return unsigned(_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_EQ_OQ))); }
+    static vec_t min(vec_t a, vec_t b) { return _mm256_min_ps(b, a); }
+    static vec_t max(vec_t a, vec_t b) { return _mm256_max_ps(b, a); }
+    static size_t popcount(mask_t m) { return size_t(_mm_popcnt_u32(m)); }
+    static element_t *compress_store(element_t *dest, vec_t v, mask_t m) {
+        _mm256_storeu_ps(dest, _mm256_permutevar8x32_ps(v, permutation_8(m)));
+        return dest + popcount(m);
+    }
+};
+
+struct avx2_ops_double {
+    typedef double element_t;
+    typedef __m256d vec_t;
+    typedef unsigned mask_t;
+    static constexpr ptrdiff_t lanes = 4;
+
+    static vec_t load(element_t const *p) { return _mm256_loadu_pd(p); }
+    static void store(element_t *p, vec_t v) { _mm256_storeu_pd(p, v); }
+    static vec_t broadcast(element_t v) { return _mm256_set1_pd(v); }
+    static mask_t less(vec_t a, vec_t b) { return unsigned(_mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_LT_OQ))); }
+    static mask_t less_equal(vec_t a, vec_t b) { return unsigned(_mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_LE_OQ))); }
+    static mask_t equal(vec_t a, vec_t b) { return unsigned(_mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_EQ_OQ))); }
+    static vec_t min(vec_t a, vec_t b) { return _mm256_min_pd(b, a); }
+    static vec_t max(vec_t a, vec_t b) { return _mm256_max_pd(b, a); }
+    static size_t popcount(mask_t m) { return size_t(_mm_popcnt_u32(m)); }
+    static element_t *compress_store(element_t *dest, vec_t v, mask_t m) {
+        __m256i moved = _mm256_permutevar8x32_epi32(_mm256_castpd_si256(v), permutation_4(m));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest), moved);
+        return dest + popcount(m);
+    }
+};
+
+template<> filter_kernel_set<int32_t> const &avx2_filter_kernels<int32_t>() {
+    static constexpr filter_kernel_set<int32_t> kernels = simd_filter_kernels<avx2_ops_int32>();
+    return kernels;
+}
+
+template<> filter_kernel_set<int64_t> const &avx2_filter_kernels<int64_t>() {
+    static constexpr filter_kernel_set<int64_t> kernels = simd_filter_kernels<avx2_ops_int64>();
+    return kernels;
+}
+
+template<> filter_kernel_set<float> const &avx2_filter_kernels<float>() {
+    static constexpr filter_kernel_set<float> kernels = simd_filter_kernels<avx2_ops_float>();
+    return kernels;
+}
+
+template<> filter_kernel_set<double> const &avx2_filter_kernels<double>() {
+    static constexpr filter_kernel_set<double> kernels = simd_filter_kernels<avx2_ops_double>();
+    return kernels;
+}
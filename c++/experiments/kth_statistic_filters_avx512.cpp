@@ -0,0 +1,117 @@
+/*
+ * AVX-512 versions of the filtering kernels.
+ *
+ * The selected lanes are compressed within a register and then the whole vector is stored,
+ * which is much faster than the masked compress-store to memory on some processors.
+ *
+ * This file must be compiled with -mavx512f.
+ */
+
+#include <immintrin.h>
+
+#include "kth_statistic_filters_simd.h"
+
+struct avx512_ops_int32 {
+    typedef int32_t element_t;
+    typedef __m512i vec_t;
+    typedef __mmask16 mask_t;
+    static constexpr ptrdiff_t lanes = 16;
+
+    static vec_t load(element_t const *p) { return _mm512_loadu_si512(p); }
+    static void store(element_t *p, vec_t v) { _mm512_storeu_si512(p, v); }
+    static vec_t broadcast(element_t v) { return _mm512_set1_epi32(v); }
+    static mask_t less(vec_t a, vec_t b) { return _mm512_cmplt_epi32_mask(a, b); }
+    static mask_t less_equal(vec_t a, vec_t b) { return _mm512_cmple_epi32_mask(a, b); }
+    static mask_t equal(vec_t a, vec_t b) { return _mm512_cmpeq_epi32_mask(a, b); }
+    // blends, as the min and max intrinsics make GCC warn about its own headers (here and below)
+    static vec_t min(vec_t a, vec_t b) { return _mm512_mask_blend_epi32(less(b, a), a, b); }
+    static vec_t max(vec_t a, vec_t b) { return _mm512_mask_blend_epi32(less(a, b), a, b); }
+    static size_t popcount(mask_t m) { return size_t(__builtin_popcount(m)); }
+    static element_t *compress_store(element_t *dest, vec_t v, mask_t m) {
+        _mm512_storeu_si512(dest, _mm512_maskz_compress_epi32(m, v));
+        return dest + popcount(m);
+    }
+};
+
+struct avx512_ops_int64 {
+    typedef int64_t element_t;
+    typedef __m512i vec_t;
+    typedef __mmask8 mask_t;
+    static constexpr ptrdiff_t lanes = 8;
+
+    static vec_t load(element_t const *p) { return _mm512_loadu_si512(p); }
+    static void store(element_t *p, vec_t v) { _mm512_storeu_si512(p, v); }
+    static vec_t broadcast(element_t v) { return _mm512_set1_epi64(v); }
+    static mask_t less(vec_t a, vec_t b) { return _mm512_cmplt_epi64_mask(a, b); }
+    static mask_t less_equal(vec_t a, vec_t b) { return _mm512_cmple_epi64_mask(a, b); }
+    static mask_t equal(vec_t a, vec_t b) { return _mm512_cmpeq_epi64_mask(a, b); }
+    static vec_t min(vec_t a, vec_t b) { return _mm512_mask_blend_epi64(less(b, a), a, b); }
+    static vec_t max(vec_t a, vec_t b) { return _mm512_mask_blend_epi64(less(a, b), a, b); }
+    static size_t popcount(mask_t m) { return size_t(__builtin_popcount(m)); }
+    static element_t *compress_store(element_t *dest, vec_t v, mask_t m) {
+        _mm512_storeu_si512(dest, _mm512_maskz_compress_epi64(m, v));
+        return dest + popcount(m);
+    }
+};
+
+struct avx512_ops_float {
+    typedef float element_t;
+    typedef __m512 vec_t;
+    typedef __mmask16 mask_t;
+    static constexpr ptrdiff_t lanes = 16;
+
+    static vec_t load(element_t const *p) { return _mm512_loadu_ps(p); }
+    static void store(element_t *p, vec_t v) { _mm512_storeu_ps(p, v); }
+    static vec_t broadcast(element_t v) { return _mm512_set1_ps(v); }
+    static mask_t less(vec_t a, vec_t b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+    static mask_t less_equal(vec_t a, vec_t b) { return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ); }
+    static mask_t equal(vec_t a, vec_t b) { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+    static vec_t min(vec_t a, vec_t b) { return _mm512_mask_blend_ps(less(b, a), a, b); }
+    static vec_t max(vec_t a, vec_t b) { return _mm512_mask_blend_ps(less(a, b), a, b); }
+    static size_t popcount(mask_t m) { return size_t(__builtin_popcount(m)); }
+    static element_t *compress_store(element_t *dest, vec_t v, mask_t m) {
+        _mm512_storeu_ps(dest, _mm512_maskz_compress_ps(m, v));
+        return dest + popcount(m);
+    }
+};
+
+struct avx512_ops_double {
+    typedef double element_t;
+    typedef __m512d vec_t;
+    typedef __mmask8 mask_t;
+    static constexpr ptrdiff_t lanes = 8;
+
+    static vec_t load(element_t const *p) { return _mm512_loadu_pd(p); }
+    static void store(element_t *p, vec_t v) { _mm512_storeu_pd(p, v); }
+    static vec_t broadcast(element_t v) { return _mm512_set1_pd(v); }
+    static mask_t less(vec_t a, vec_t b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+    static mask_t less_equal(vec_t a, vec_t b) { return _mm512_cmp_pd_mask(a, b, _CMP_LE_OQ); }
+    static mask_t equal(vec_t a, vec_t b) { return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ); }
+    static vec_t min(vec_t a, vec_t b) { return _mm512_mask_blend_pd(less(b, a), a, b); }
+    static vec_t max(vec_t a, vec_t b) { return _mm512_mask_blend_pd(less(a, b), a, b); }
+    static size_t popcount(mask_t m) { return size_t(__builtin_popcount(m)); }
+    static element_t *compress_store(element_t *dest, vec_t v, mask_t m) {
+        _mm512_storeu_pd(dest, _mm512_maskz_compress_pd(m, v));
+        return dest + popcount(m);
+    }
+};
+
+template<> filter_kernel_set<int32_t> const &avx512_filter_kernels<int32_t>() {
+    static constexpr filter_kernel_set<int32_t> kernels = simd_filter_kernels<avx512_ops_int32>();
+    return kernels;
+}
+
+template<> filter_kernel_set<int64_t> const &avx512_filter_kernels<int64_t>() {
+    static constexpr filter_kernel_set<int64_t> kernels = simd_filter_kernels<avx512_ops_int64>();
+    return kernels;
+}
+
+template<> filter_kernel_set<float> const &avx512_filter_kernels<float>() {
+    static constexpr filter_kernel_set<float> kernels = simd_filter_kernels<avx512_ops_float>();
+    return kernels;
+}
+
+template<> filter_kernel_set<double> const &avx512_filter_kernels<double>() {
+    static constexpr filter_kernel_set<double> kernels = simd_filter_kernels<avx512_ops_double>();
+    return kernels;
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+/*
+ * Vectorized filtering kernels, generic in the instruction set.
+ *
+ * An ops structure describes one element type on one instruction set:
+ * - element_t, vec_t, mask_t, and the number of lanes;
+ * - load, broadcast and the comparisons returning a lane mask;
+ * - compress_store, which writes the lanes selected by the mask to the front of dest
+ *   and may additionally write garbage up to dest + lanes;
+ * - popcount of a mask;
+ * - store, minimum and maximum, for compare_exchange_lines.
+ *
+ * This header is included only by the translation units compiled with the matching
+ * instruction set flags. Since every instruction set has its own ops structures,
+ * the instantiations below never get merged with ones compiled for another instruction set.
+ * For the same reason, nothing from the standard library is used here.
+ */
+
+#include "kth_statistic_filters.h"
+
+template<typename ops>
+typename ops::element_t *simd_filter_not_greater(typename ops::element_t const *from,
+                                                 typename ops::element_t const *until,
+                                                 typename ops::element_t upper,
+                                                 typename ops::element_t *dest) {
+    typename ops::vec_t v_upper = ops::broadcast(upper);
+    for (; until - from >= ops::lanes; from += ops::lanes) {
+        typename ops::vec_t v = ops::load(from);
+        dest = ops::compress_store(dest, v, ops::less_equal(v, v_upper));
+    }
+    for (; from < until; ++from) {
+        *dest = *from;
+        dest += *from <= upper;
+    }
+    return dest;
+}
+
+template<typename ops>
+typename ops::element_t *simd_filter_not_less(typename ops::element_t const *from,
+                                              typename ops::element_t const *until,
+                                              typename ops::element_t lower,
+                                              typename ops::element_t *dest) {
+    typename ops::vec_t v_lower = ops::broadcast(lower);
+    for (; until - from >= ops::lanes; from += ops::lanes) {
+        typename ops::vec_t v = ops::load(from);
+        dest = ops::compress_store(dest, v, ops::less_equal(v_lower, v));
+    }
+    for (; from < until; ++from) {
+        *dest = *from;
+        dest += *from >= lower;
+    }
+    return dest;
+}
+
+template<typename ops>
+typename ops::element_t *simd_filter_between(typename ops::element_t const *from,
+                                             typename ops::element_t const *until,
+                                             typename ops::element_t lower,
+                                             typename ops::element_t upper,
+                                             typename ops::element_t *dest,
+                                             size_t &n_less) {
+    typename ops::vec_t v_lower = ops::broadcast(lower);
+    typename ops::vec_t v_upper = ops::broadcast(upper);
+    size_t count_less = 0;
+    for (; until - from >= ops::lanes; from += ops::lanes) {
+        typename ops::vec_t v = ops::load(from);
+        typename ops::mask_t is_lower = ops::less(v, v_lower);
+        typename ops::mask_t is_good = ops::less_equal(v, v_upper) & ~is_lower;
+        count_less += ops::popcount(is_lower);
+        dest = ops::compress_store(dest, v, is_good);
+    }
+    for (; from < until; ++from) {
+        *dest = *from;
+        bool is_lower = *from < lower;
+        bool is_good = !is_lower && *from <= upper;
+        count_less += is_lower;
+        dest += is_good;
+    }
+    n_less += count_less;
+    return dest;
+}
+
+template<typename ops>
+void simd_count_less_equal(typename ops::element_t const *from,
+                           typename ops::element_t const *until,
+                           typename ops::element_t value,
+                           size_t &n_less, size_t &n_equal) {
+    typename ops::vec_t v_value = ops::broadcast(value);
+    size_t count_less = 0;
+    size_t count_eq = 0;
+    for (; until - from >= ops::lanes; from += ops::lanes) {
+        typename ops::vec_t v = ops::load(from);
+        count_less += ops::popcount(ops::less(v, v_value));
+        count_eq += ops::popcount(ops::equal(v, v_value));
+    }
+    for (; from < until; ++from) {
+        count_less += *from < value;
+        count_eq += *from == value;
+    }
+    n_less += count_less;
+    n_equal += count_eq;
+}
+
+template<typename ops>
+typename ops::element_t *simd_filter_bands(typename ops::element_t const *from,
+                                           typename ops::element_t const *until,
+                                           typename ops::element_t const *bounds,
+                                           size_t n_bounds, bool inside_initially,
+                                           typename ops::element_t *dest,
+                                           size_t *n_passed) {
+    // as the bounds are sorted, an element is inside a band if it passed an odd number of bounds,
+    // counting the initial state, so the parity of the pass masks tells which elements to keep
+    typename ops::mask_t initial = inside_initially ? typename ops::mask_t((size_t(1) << ops::lanes) - 1) : 0;
+    for (; until - from >= ops::lanes; from += ops::lanes) {
+        typename ops::vec_t v = ops::load(from);
+        typename ops::mask_t inside = initial;
+        bool opening = !inside_initially;
+        for (size_t i = 0; i < n_bounds; ++i, opening = !opening) {
+            typename ops::vec_t bound = ops::broadcast(bounds[i]);
+            typename ops::mask_t passed = opening ? ops::less_equal(bound, v) : ops::less(bound, v);
+            n_passed[i] += ops::popcount(passed);
+            inside ^= passed;
+        }
+        dest = ops::compress_store(dest, v, inside);
+    }
+    for (; from < until; ++from) {
+        bool inside = inside_initially;
+        bool opening = !inside_initially;
+        for (size_t i = 0; i < n_bounds; ++i, opening = !opening) {
+            bool passed = opening ? *from >= bounds[i] : *from > bounds[i];
+            n_passed[i] += passed;
+            inside ^= passed;
+        }
+        *dest = *from;
+        dest += inside;
+    }
+    return dest;
+}
+
+template<typename ops>
+void simd_compare_exchange_lines(typename ops::element_t *lines, uint8_t const *pairs, size_t n_pairs) {
+    constexpr ptrdiff_t line = ptrdiff_t(batch_line_bytes / sizeof(typename ops::element_t));
+    for (size_t j = 0; j < n_pairs; ++j) {
+        typename ops::element_t *a = lines + pairs[2 * j] * line, *b = lines + pairs[2 * j + 1] * line;
+        for (ptrdiff_t l = 0; l < line; l += ops::lanes) {
+            typename ops::vec_t v_a = ops::load(a + l), v_b = ops::load(b + l);
+            ops::store(a + l, ops::min(v_a, v_b));
+            ops::store(b + l, ops::max(v_a, v_b));
+        }
+    }
+}
+
+template<typename ops>
+constexpr filter_kernel_set<typename ops::element_t> simd_filter_kernels() {
+    return { &simd_filter_not_greater<ops>,
+             &simd_filter_not_less<ops>,
+             &simd_filter_between<ops>,
+             &simd_count_less_equal<ops>,
+             &simd_filter_bands<ops>,
+             &simd_compare_exchange_lines<ops> };
+}
+
+// Defined in kth_statistic_filters_avx2.cpp and kth_statistic_filters_avx512.cpp
+template<typename element_t> filter_kernel_set<element_t> const &avx2_filter_kernels();
+template<typename element_t> filter_kernel_set<element_t> const &avx512_filter_kernels();
+
+template<> filter_kernel_set<int32_t> const &avx2_filter_kernels<int32_t>();
+template<> filter_kernel_set<int64_t> const &avx2_filter_kernels<int64_t>();
+template<> filter_kernel_set<float> const &avx2_filter_kernels<float>();
+template<> filter_kernel_set<double> const &avx2_filter_kernels<double>();
+
+template<> filter_kernel_set<int32_t> const &avx512_filter_kernels<int32_t>();
+template<> filter_kernel_set<int64_t> const &avx512_filter_kernels<int64_t>();
+template<> filter_kernel_set<float> const &avx512_filter_kernels<float>();
+template<> filter_kernel_set<double> const &avx512_filter_kernels<double>();
@@ -0,0 +1,300 @@
+#pragma once
+
+/*
+ * Floyd-Rivest selection (R. W. Floyd, R. L. Rivest, "Algorithm 489: SELECT", CACM 18(3), 1975),
+ * the classic algorithm to which the predicting engines are the closest.
+ *
+ * floyd_rivest_kth_statistic is the original in-place algorithm. While the range is larger than a cutoff,
+ * it recursively selects in a contiguous part of the range around k, of size about n^(2/3),
+ * shifted towards the middle by a few standard deviations of the rank, so that the element found there
+ * is very likely to be close to the sought one, but on its far side. This element is then the pivot
+ * of a partitioning pass, which leaves only a small range around k. The smaller ranges are done
+ * with the same pass, with the element at k as the pivot. Unlike the random sample of the paper,
+ * a contiguous part can be a bad sample of a structured input, so the reduction is tracked
+ * in the same way as in introspective_select, and the rest is left to it if the budget is exhausted.
+ *
+ * floyd_rivest_aux_kth_statistic is its out-of-place variant, the same scheme as in the predicting engines:
+ * a strided sample is copied to the aux array, where the in-place algorithm selects two pivots around
+ * the expected rank of k; then a single pass over the array counts the elements below the lower pivot
+ * and copies the elements between the pivots to the aux array, where k is then selected if it is there.
+ * The gap between the pivots is a few standard deviations of that rank, and the pass is plain scalar code, without
+ * the vectorized kernels and the tiered recovery of the predicting engines: a miss simply selects
+ * on the array in place. Hence, the difference between the two variants tells what the aux memory
+ * buys by itself, and the difference to the predicting engines what their other parts do.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "kth_statistic.h"
+#include "kth_statistic_hoare.h"
+#include "kth_statistic_network.h"
+#include "workspace.h"
+
+template<typename element_t>
+struct floyd_rivest_select {
+    // the constants of the paper; the cutoffs from 200 to 2000 were all within noise of each other here
+    static constexpr ptrdiff_t cutoff = 600;
+    static constexpr double sample_factor = 0.5;
+    static constexpr double deviation_factor = 0.5;
+    static constexpr size_t budget_factor = 6;
+
+    // Selects arr_k within [from, to], inclusive; returns whether it had to use introspective_select
+    static bool select(element_t *from, element_t *to, element_t *arr_k) {
+        size_t budget = budget_factor * size_t(to - from + 1);
+        return select(from, to, arr_k, budget);
+    }
+
+    // The same for the sorted ranks [ks_begin, ks_end) relative to arr; returns the number of fallbacks
+    static size_t select_many(element_t *arr, element_t *from, element_t *to, size_t const *ks_begin, size_t const *ks_end) {
+        size_t fallbacks = 0;
+        while (ks_begin != ks_end) {
+            size_t const *ks_mid = ks_begin + (ks_end - ks_begin) / 2;
+            element_t *arr_k = arr + *ks_mid;
+            fallbacks += select(from, to, arr_k);
+            fallbacks += select_many(arr, from, arr_k - 1, ks_begin, ks_mid);
+            from = arr_k + 1;
+            ks_begin = ks_mid + 1;
+        }
+        return fallbacks;
+    }
+
+private:
+    static bool select(element_t *from, element_t *to, element_t *arr_k, size_t &budget) {
+        while (to > from) {
+            if (uses_networks<element_t> && size_t(to - from) < max_network_size) {
+                network_sort(from, size_t(to - from) + 1);
+                break;
+            }
+            ptrdiff_t n = to - from + 1;
+            if (budget < size_t(n)) {
+                introspective_select<element_t>::select(from, to, arr_k,
+                                                        introspective_select<element_t>::default_budget_factor);
+                return true;
+            }
+            budget -= n;
+            if (n > cutoff) {
+                ptrdiff_t i = arr_k - from + 1;
+                double z = std::log(double(n));
+                double s = sample_factor * std::exp(2 * z / 3);
+                double sd = deviation_factor * std::sqrt(z * s * (n - s) / n) * (2 * i < n ? -1 : 1);
+                ptrdiff_t k = arr_k - from;
+                ptrdiff_t sample_from = std::max(ptrdiff_t(0), ptrdiff_t(k - i * s / n + sd));
+                ptrdiff_t sample_to = std::min(n - 1, ptrdiff_t(k + (n - i) * s / n + sd));
+                // the sample does its own accounting, so it does not consume the budget of this range
+                size_t sample_budget = budget_factor * size_t(sample_to - sample_from + 1);
+                select(from + sample_from, from + sample_to, arr_k, sample_budget);
+            }
+
+            element_t pivot = *arr_k;
+            element_t *l = from, *r = to;
+            std::swap(*from, *arr_k);
+            if (*to > pivot) {
+                std::swap(*to, *from);
+            }
+            while (l < r) {
+                std::swap(*l, *r);
+                ++l;
+                --r;
+                while (*l < pivot) ++l;
+                while (*r > pivot) --r;
+            }
+            if (*from == pivot) {
+                std::swap(*from, *r);
+            } else {
+                ++r;
+                std::swap(*r, *to);
+            }
+            // the pivot is now at r, with no greater elements before it and no smaller ones after it
+            if (r == arr_k) {
+                break;
+            }
+            if (r < arr_k) {
+                from = r + 1;
+            } else {
+                to = r - 1;
+            }
+        }
+        return false;
+    }
+};
+
+template<typename element_t>
+struct floyd_rivest_kth_statistic : kth_statistic<element_t> {
+private:
+    char const *_name;
+    size_t _calls, _fallbacks;
+
+public:
+    floyd_rivest_kth_statistic(char const *name = "Floyd-Rivest")
+    : _name(name), _calls(0), _fallbacks(0) {}
+
+    char const *name() const { return _name; }
+    bool is_inplace() const { return true; }
+    bool is_destructive() const { return false; }
+    size_t size() { return std::numeric_limits<size_t>::max(); }
+    void resize(size_t new_size) {}
+
+    element_t find(element_t *arr, size_t size, size_t k) {
+        ++_calls;
+        if (size >= 2) {
+            _fallbacks += floyd_rivest_select<element_t>::select(arr, arr + size - 1, arr + k);
+        }
+        return arr[k];
+    }
+
+    // find() leaves the array partitioned
+    void partition_at(element_t *arr, size_t size, size_t k) {
+        find(arr, size, k);
+    }
+
+    void find_many(element_t *arr, size_t size, size_t const *ks, size_t n_ks, element_t *out) {
+        ++_calls;
+        if (size >= 2) {
+            std::vector<size_t> sorted_ks = sorted_unique_ks(ks, n_ks);
+            _fallbacks += floyd_rivest_select<element_t>::select_many(arr, arr, arr + size - 1,
+                                                                      sorted_ks.data(), sorted_ks.data() + sorted_ks.size());
+        }
+        for (size_t i = 0; i < n_ks; ++i) {
+            out[i] = arr[ks[i]];
+        }
+    }
+
+    void display_and_reset_statistics(std::ostream &out) {
+        out << "    [Calls: " << _calls
+            << ", introselect fallbacks: " << _fallbacks
+            << "]" << std::endl;
+        _calls = 0;
+        _fallbacks = 0;
+    }
+};
+
+template<typename element_t>
+struct floyd_rivest_aux_kth_statistic : kth_statistic<element_t> {
+private:
+    // below this, the sample would be too small to predict anything
+    static constexpr size_t min_size = 2 * floyd_rivest_select<element_t>::cutoff;
+    // the gap between the pivots, in standard deviations of the rank of k in the sample;
+    // the larger gaps of the paper miss less often, but the larger band costs more than the misses
+    static constexpr double gap_factor = 2.5;
+
+    size_t _size;
+    char const *_name;
+    workspace *_workspace;
+    bool _owns_workspace;
+    // the memory of the workspace for the current call
+    element_t *_mem;
+    size_t _calls, _hits, _misses, _samples, _band;
+
+public:
+    char const *name() const { return _name; }
+    bool is_inplace() const { return false; }
+    bool is_destructive() const { return false; }
+    size_t size() { return _size; }
+
+    floyd_rivest_aux_kth_statistic(char const *name = "Floyd-Rivest, aux memory",
+                                   size_t initial_size = 1,
+                                   workspace *shared_workspace = nullptr)
+    : _size(initial_size), _name(name),
+      _workspace(shared_workspace != nullptr ? shared_workspace : new workspace()),
+      _owns_workspace(shared_workspace == nullptr),
+      _calls(0), _hits(0), _misses(0), _samples(0), _band(0) {
+        _mem = _workspace->get<element_t>(_size);
+    }
+
+    void resize(size_t new_size) {
+        _size = new_size;
+        _mem = _workspace->get<element_t>(_size);
+    }
+
+    ~floyd_rivest_aux_kth_statistic() {
+        if (_owns_workspace) {
+            delete _workspace;
+        }
+    }
+
+    void display_and_reset_statistics(std::ostream &out) {
+        size_t predicted = _hits + _misses;
+        out << "    [Calls: " << _calls
+            << ", hits: " << _hits
+            << ", misses: " << _misses
+            << ", samples avg: " << double(_samples) / predicted
+            << ", band avg: " << double(_band) / predicted
+            << "]" << std::endl;
+        _calls = 0;
+        _hits = 0;
+        _misses = 0;
+        _samples = 0;
+        _band = 0;
+    }
+
+    element_t find(element_t *start, size_t size, size_t k) {
+        ++_calls;
+        if (size < min_size) {
+            if (size >= 2) {
+                floyd_rivest_select<element_t>::select(start, start + size - 1, start + k);
+            }
+            return start[k];
+        }
+        _mem = _workspace->get<element_t>(size);
+
+        double z = std::log(double(size));
+        size_t n_samples = size_t(floyd_rivest_select<element_t>::sample_factor * std::exp(2 * z / 3));
+        size_t stride = size / n_samples;
+        element_t const *sample = start + stride / 2;
+        for (size_t i = 0; i < n_samples; ++i, sample += stride) {
+            _mem[i] = *sample;
+        }
+
+        double p = (k + 0.5) / size;
+        double expected = p * n_samples;
+        double gap = gap_factor * std::sqrt(n_samples * p * (1 - p)) + 1;
+        size_t lower_idx = expected > gap ? size_t(expected - gap) : 0;
+        size_t upper_idx = std::min(n_samples - 1, size_t(expected + gap));
+        size_t bounds_idx[] = { lower_idx, upper_idx };
+        floyd_rivest_select<element_t>::select_many(_mem, _mem, _mem + n_samples - 1, bounds_idx, bounds_idx + 2);
+        element_t lower = _mem[lower_idx], upper = _mem[upper_idx];
+        // the pivots at the ends of the sample stand for nothing beyond them
+        bool open_below = lower_idx == 0, open_above = upper_idx == n_samples - 1;
+
+        size_t n_less = 0;
+        element_t *dst = _mem;
+        for (element_t const *curr = start, *end = start + size; curr != end; ++curr) {
+            element_t value = *curr;
+            bool less = !open_below && value < lower;
+            *dst = value;
+            dst += (!less) & (open_above | (!(upper < value)));
+            n_less += less;
+        }
+        size_t n_band = dst - _mem;
+        _samples += n_samples;
+        _band += n_band;
+
+        if (k >= n_less && k - n_less < n_band) {
+            ++_hits;
+            floyd_rivest_select<element_t>::select(_mem, dst - 1, _mem + (k - n_less));
+            return _mem[k - n_less];
+        }
+        ++_misses;
+        floyd_rivest_select<element_t>::select(start, start + size - 1, start + k);
+        return start[k];
+    }
+
+    // The pivots would have to be chosen around every k, so it is the in-place algorithm here
+    void find_many(element_t *start, size_t size, size_t const *ks, size_t n_ks, element_t *out) {
+        ++_calls;
+        if (size >= 2) {
+            std::vector<size_t> sorted_ks = sorted_unique_ks(ks, n_ks);
+            floyd_rivest_select<element_t>::select_many(start, start, start + size - 1,
+                                                        sorted_ks.data(), sorted_ks.data() + sorted_ks.size());
+        }
+        for (size_t i = 0; i < n_ks; ++i) {
+            out[i] = start[ks[i]];
+        }
+    }
+};
@@ -1,12 +1,51 @@
 #pragma once
 
+#include <algorithm>
+#include <iostream>
 #include <limits>
 #include <utility>
+#include <vector>
 
 #include "kth_statistic.h"
+#include "kth_statistic_network.h"
 
 template<typename element_t>
 struct bidirectional_hoare_middle : kth_statistic<element_t> {
+private:
+    // Partitions [from, to] so that arr[k] is in place for each k in the sorted range [ks_begin, ks_end).
+    void partition_many(element_t *arr, element_t *from, element_t *to, size_t const *ks_begin, size_t const *ks_end) {
+        while (to > from && ks_begin != ks_end) {
+            if (uses_networks<element_t> && size_t(to - from) < max_network_size) {
+                network_sort(from, size_t(to - from) + 1);
+                break;
+            }
+            element_t pivot = from[(to - from) >> 1];
+            element_t *l = from, *r = to;
+            do {
+                while (*l < pivot) ++l;
+                while (*r > pivot) --r;
+                if (l <= r) {
+                    std::swap(*l, *r);
+                    ++l;
+                    --r;
+                }
+            } while (l <= r);
+            // values of k at most r go to the left, at least l to the right, others are done
+            size_t const *ks_left_end = std::upper_bound(ks_begin, ks_end, size_t(r - arr));
+            size_t const *ks_right_begin = std::lower_bound(ks_left_end, ks_end, size_t(l - arr));
+            if (ks_left_end - ks_begin < ks_end - ks_right_begin) {
+                partition_many(arr, from, r, ks_begin, ks_left_end);
+                from = l;
+                ks_begin = ks_right_begin;
+            } else {
+                partition_many(arr, l, to, ks_right_begin, ks_end);
+                to = r;
+                ks_end = ks_left_end;
+            }
+        }
+    }
+
+public:
     char const *name() const { return "bidirectional Hoare"; }
     bool is_inplace() const { return true; }
     bool is_destructive() const { return false; }
@@ -14,14 +53,14 @@ struct bidirectional_hoare_middle : kth_statistic<element_t> {
     void resize(size_t new_size) {}
 
     element_t find(element_t *arr, size_t size, size_t k) {
-        if (size == 2) {
-            if (arr[0] > arr[1]) {
-                std::swap(arr[0], arr[1]);
-            }
-        } else if (size > 2) {
+        if (size >= 2) {
             element_t *from = arr, *to = arr + size - 1;
             element_t *arr_k = arr + k;
             while (to > from) {
+                if (uses_networks<element_t> && size_t(to - from) < max_network_size) {
+                    network_sort(from, size_t(to - from) + 1);
+                    break;
+                }
                 element_t pivot = from[(to - from) >> 1];
                 element_t *l = from, *r = to;
                 do {
@@ -42,4 +81,165 @@ struct bidirectional_hoare_middle : kth_statistic<element_t> {
         }
         return arr[k];
     }
+
+    // find() leaves the array partitioned
+    void partition_at(element_t *arr, size_t size, size_t k) {
+        find(arr, size, k);
+    }
+
+    void find_many(element_t *arr, size_t size, size_t const *ks, size_t n_ks, element_t *out) {
+        if (size >= 2) {
+            std::vector<size_t> sorted_ks = sorted_unique_ks(ks, n_ks);
+            partition_many(arr, arr, arr + size - 1, sorted_ks.data(), sorted_ks.data() + sorted_ks.size());
+        }
+        for (size_t i = 0; i < n_ks; ++i) {
+            out[i] = arr[ks[i]];
+        }
+    }
+};
+
+/*
+ * Introselect: the same selection as bidirectional_hoare_middle, but guaranteed to take linear time.
+ *
+ * The middle pivot is good for most inputs, but crafted or structured ones (see hoare_middle_killer
+ * and organ_pipe in generators.h) make it remove only a few elements per round, which takes quadratic time.
+ * So the reduction is tracked: the total size of the partitioned ranges is counted against a budget
+ * of budget_factor * size. With a good pivot, the ranges shrink geometrically, and the total stays
+ * at about 2-4 times the size. Once the budget is exhausted, progress has stalled, and then one round
+ * uses the median of medians (of groups of 5) as the pivot, which leaves at most about 7/10 of the range.
+ * After that, the middle pivot gets another chance with a new budget for the remaining range.
+ * As the range shrinks geometrically from one budget to the next, the total time is still linear,
+ * while the inputs on which the middle pivot is only somewhat slow do not pay for many slow rounds.
+ */
+template<typename element_t>
+struct introspective_select {
+    static constexpr size_t default_budget_factor = 6;
+
+    // Selects arr_k within [from, to], inclusive; returns whether it had to use the median of medians
+    static bool select(element_t *from, element_t *to, element_t *arr_k, size_t budget_factor) {
+        size_t budget = budget_factor * size_t(to - from + 1);
+        bool fallback = false;
+        while (to > from) {
+            if (uses_networks<element_t> && size_t(to - from) < max_network_size) {
+                network_sort(from, size_t(to - from) + 1);
+                break;
+            }
+            size_t n = size_t(to - from) + 1;
+            element_t pivot;
+            if (budget >= n) {
+                budget -= n;
+                pivot = from[(to - from) >> 1];
+            } else {
+                fallback = true;
+                pivot = median_of_medians(from, to);
+                budget = budget_factor * n;
+            }
+            element_t *l = from, *r = to;
+            do {
+                while (*l < pivot) ++l;
+                while (*r > pivot) --r;
+                if (l <= r) {
+                    std::swap(*l, *r);
+                    ++l;
+                    --r;
+                }
+            } while (l <= r);
+            if (arr_k <= r) {
+                to = r;
+            } else if (l <= arr_k) {
+                from = l;
+            } else break;
+        }
+        return fallback;
+    }
+
+    // Partitions [from, to] so that arr[k] is in place for each k in the sorted range [ks_begin, ks_end),
+    // by selecting the middle k and then the ks on either side of it; returns the number of fallbacks
+    static size_t select_many(element_t *arr, element_t *from, element_t *to,
+                              size_t const *ks_begin, size_t const *ks_end, size_t budget_factor) {
+        size_t fallbacks = 0;
+        while (ks_begin != ks_end) {
+            size_t const *ks_mid = ks_begin + (ks_end - ks_begin) / 2;
+            element_t *arr_k = arr + *ks_mid;
+            fallbacks += select(from, to, arr_k, budget_factor);
+            fallbacks += select_many(arr, from, arr_k - 1, ks_begin, ks_mid, budget_factor);
+            from = arr_k + 1;
+            ks_begin = ks_mid + 1;
+        }
+        return fallbacks;
+    }
+
+private:
+    // The median of the medians of the groups of 5 in [from, to], which are moved to its beginning
+    static element_t median_of_medians(element_t *from, element_t *to) {
+        size_t n = size_t(to - from) + 1;
+        if (n <= 5) {
+            network_sort(from, n);
+            return from[n / 2];
+        }
+        size_t n_groups = n / 5;
+        for (size_t g = 0; g < n_groups; ++g) {
+            element_t *group = from + 5 * g;
+            network_sort(group, 5);
+            // from + g is in a group which is already done
+            std::swap(from[g], group[2]);
+        }
+        element_t *median = from + n_groups / 2;
+        select(from, from + n_groups - 1, median, default_budget_factor);
+        return *median;
+    }
+};
+
+template<typename element_t>
+struct introspective_hoare : kth_statistic<element_t> {
+private:
+    char const *_name;
+    size_t _budget_factor;
+    size_t _calls, _fallbacks;
+
+public:
+    // With a zero budget factor, the pivot is always the median of medians
+    introspective_hoare(char const *name = "introspective Hoare",
+                        size_t budget_factor = introspective_select<element_t>::default_budget_factor)
+    : _name(name), _budget_factor(budget_factor), _calls(0), _fallbacks(0) {}
+
+    char const *name() const { return _name; }
+    bool is_inplace() const { return true; }
+    bool is_destructive() const { return false; }
+    size_t size() { return std::numeric_limits<size_t>::max(); }
+    void resize(size_t new_size) {}
+
+    element_t find(element_t *arr, size_t size, size_t k) {
+        ++_calls;
+        if (size >= 2) {
+            _fallbacks += introspective_select<element_t>::select(arr, arr + size - 1, arr + k, _budget_factor);
+        }
+        return arr[k];
+    }
+
+    // find() leaves the array partitioned
+    void partition_at(element_t *arr, size_t size, size_t k) {
+        find(arr, size, k);
+    }
+
+    void find_many(element_t *arr, size_t size, size_t const *ks, size_t n_ks, element_t *out) {
+        ++_calls;
+        if (size >= 2) {
+            std::vector<size_t> sorted_ks = sorted_unique_ks(ks, n_ks);
+            _fallbacks += introspective_select<element_t>::select_many(arr, arr, arr + size - 1,
+                                                                       sorted_ks.data(), sorted_ks.data() + sorted_ks.size(),
+                                                                       _budget_factor);
+        }
+        for (size_t i = 0; i < n_ks; ++i) {
+            out[i] = arr[ks[i]];
+        }
+    }
+
+    void display_and_reset_statistics(std::ostream &out) {
+        out << "    [Calls: " << _calls
+            << ", median of medians fallbacks: " << _fallbacks
+            << "]" << std::endl;
+        _calls = 0;
+        _fallbacks = 0;
+    }
 };
@@ -0,0 +1,282 @@
+#pragma once
+
+/*
+ * Out-of-core version of predicting_kth_statistic, for arrays which do not fit in memory.
+ *
+ * The input is a read-only memory-mapped file (see mapped_array.h), which is never modified.
+ * - The phase-1 sample is taken with strided reads, and then sorted in memory.
+ * - The band of the sample around k is chosen just like in predicting_kth_statistic.
+ * - A sequential streaming pass (with MADV_SEQUENTIAL) counts the elements below the lower bound,
+ *   above the upper bound, and equal to either of them, without copying anything.
+ * - If k is among the elements equal to a bound, which is where the inputs with many duplicates end up,
+ *   that bound is the answer. If k is strictly inside the band, and the band is at most max_band_size
+ *   elements, a second pass copies it to an in-memory buffer of exactly its size,
+ *   where k is found with std::nth_element.
+ * - If the band is too large, it is narrowed: a pass takes a new sample, evenly spaced among the elements
+ *   strictly inside the band, and the new band is chosen from it, strictly inside the old one,
+ *   which shrinks the band at every step, so that only max_band_size elements are ever kept in memory.
+ * - If k is outside the band, there is no way to fall back to an in-memory algorithm on the whole array,
+ *   so the counts are used to move the band to the side which contains k, the band is widened,
+ *   and another counting pass is made. Eventually the band becomes unbounded on the side which contains k
+ *   (or reaches the bound of the band which it narrows), so this always terminates.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <vector>
+
+#include "kth_statistic_filters.h"
+#include "kth_statistic_network.h"
+#include "kth_statistic_predictor_simple.h"
+#include "mapped_array.h"
+
+template<typename element_t>
+struct mapped_predicting_kth_statistic {
+private:
+    // a pass reads the array in chunks which stay in the cache for all the kernels which it runs on them
+    static constexpr size_t chunk_size = size_t(1) << 14;
+
+    // a bound of a band, which is absent if the band is unbounded on that side
+    struct bound {
+        bool present;
+        element_t value;
+    };
+
+    struct counts {
+        size_t n_less_lower, n_equal_lower, n_equal_upper, n_greater_upper;
+    };
+
+    char const *_name;
+    sample_sizes &_sample_sizes;
+    size_t _max_band_size;
+    std::vector<element_t> _sample, _chunk, _buffer;
+    size_t _hits, _misses, _passes, _widenings, _narrowings, _counted;
+    size_t _phase_1_samples, _n_filtered;
+
+    // Calls f(from, until) for the consecutive chunks of the array, in a sequential pass
+    template<typename visitor_t>
+    void pass(mapped_array<element_t> const &arr, visitor_t f) {
+        ++_passes;
+        element_t const *data = arr.data();
+        size_t size = arr.size();
+        arr.advise(0, size, MADV_SEQUENTIAL);
+        for (size_t from = 0; from < size; from += chunk_size) {
+            f(data + from, data + std::min(size, from + chunk_size));
+        }
+        arr.advise(0, size, MADV_NORMAL);
+    }
+
+    // Counts the elements of the array below, equal to and above the bounds which are present;
+    // equal bounds are counted once, as the lower one
+    counts count(mapped_array<element_t> const &arr, bound lower, bound upper) {
+        filter_kernel_set<element_t> const &filters = filter_kernels<element_t>();
+        const bool same_bounds = lower.present && upper.present && !(lower.value < upper.value);
+        counts result = { 0, 0, 0, 0 };
+        size_t upper_less = 0, upper_equal = 0;
+        pass(arr, [&](element_t const *from, element_t const *until) {
+            if (lower.present) {
+                filters.count_less_equal(from, until, lower.value, result.n_less_lower, result.n_equal_lower);
+            }
+            if (upper.present && !same_bounds) {
+                filters.count_less_equal(from, until, upper.value, upper_less, upper_equal);
+            }
+        });
+        if (same_bounds) {
+            result.n_greater_upper = arr.size() - result.n_less_lower - result.n_equal_lower;
+        } else if (upper.present) {
+            result.n_equal_upper = upper_equal;
+            result.n_greater_upper = arr.size() - upper_less - upper_equal;
+        }
+        return result;
+    }
+
+    // Calls f(from, until) for the runs of the elements strictly inside the band, in the order of the array
+    template<typename visitor_t>
+    void strictly_inside(mapped_array<element_t> const &arr, bound lower, bound upper, visitor_t f) {
+        filter_kernel_set<element_t> const &filters = filter_kernels<element_t>();
+        element_t bounds[2];
+        size_t n_passed[2] = { 0, 0 };
+        size_t n_bounds = 0;
+        if (lower.present) bounds[n_bounds++] = lower.value;
+        if (upper.present) bounds[n_bounds++] = upper.value;
+        _chunk.resize(chunk_size);
+        pass(arr, [&](element_t const *from, element_t const *until) {
+            element_t *end = filters.bands(from, until, bounds, n_bounds, !lower.present, _chunk.data(), n_passed);
+            element_t *out = _chunk.data();
+            for (element_t *curr = _chunk.data(); curr != end; ++curr) {
+                *out = *curr;
+                out += !(lower.present && *curr == lower.value) & !(upper.present && *curr == upper.value);
+            }
+            f(_chunk.data(), out);
+        });
+    }
+
+public:
+    // Without a limit, the band may grow as large as the array in the worst case
+    mapped_predicting_kth_statistic(sample_sizes &sample_sizes, char const *name,
+                                    size_t max_band_size = size_t(1) << 26)
+    : _name(name), _sample_sizes(sample_sizes), _max_band_size(std::max<size_t>(1, max_band_size)),
+      _hits(0), _misses(0), _passes(0), _widenings(0), _narrowings(0), _counted(0),
+      _phase_1_samples(0), _n_filtered(0) {}
+
+    char const *name() const { return _name; }
+    size_t hits() const { return _hits; }
+    size_t misses() const { return _misses; }
+    // every pass over the array: a count for every band, a copy or a new sample for some of them
+    size_t passes() const { return _passes; }
+    size_t widenings() const { return _widenings; }
+    size_t narrowings() const { return _narrowings; }
+    // the finds which were answered by the counts alone, as k was among the elements equal to a bound
+    size_t counted() const { return _counted; }
+
+    void display_and_reset_statistics(std::ostream &out) {
+        out << "    [Hits: " << _hits
+            << ", misses: " << _misses
+            << ", passes: " << _passes
+            << ", widenings: " << _widenings
+            << ", narrowings: " << _narrowings
+            << ", answered by counts: " << _counted
+            << ", phase 1 samples avg: " << double(_phase_1_samples) / (_hits + _misses)
+            << ", filtered avg: " << double(_n_filtered) / (_hits + _misses)
+            << "]" << std::endl;
+        _hits = 0;
+        _misses = 0;
+        _passes = 0;
+        _widenings = 0;
+        _narrowings = 0;
+        _counted = 0;
+        _phase_1_samples = 0;
+        _n_filtered = 0;
+    }
+
+    element_t find(mapped_array<element_t> const &arr, size_t k) {
+        element_t const *data = arr.data();
+        const size_t size = arr.size();
+        assert(k < size);
+
+        if (!_sample_sizes.is_size_acceptable(size)) {
+            _buffer.assign(data, data + size);
+            nth_element_or_network(_buffer.data(), _buffer.data() + k, _buffer.data() + size);
+            return _buffer[k];
+        }
+
+        const size_t n_samples = _sample_sizes.n_phase_1_samples(size);
+        const size_t proportion = size / n_samples;
+        const size_t offset_from_below = (size - (n_samples - 1) * proportion + 1) / 2;
+
+        _sample.resize(n_samples);
+        arr.advise(0, size, MADV_RANDOM);
+        for (size_t i = 0, j = offset_from_below; i < n_samples; ++i, j += proportion) {
+            _sample[i] = data[j];
+        }
+        arr.advise(0, size, MADV_NORMAL);
+        std::sort(_sample.begin(), _sample.end());
+        _phase_1_samples += n_samples;
+
+        const size_t n_samples_2 = _sample_sizes.n_phase_2_samples(size, n_samples);
+        assert(n_samples_2 <= n_samples);
+
+        // the same band as predicting_kth_statistic would use
+        size_t lower_idx, upper_idx;
+        bool unbounded_below = false, unbounded_above = false;
+        if (k < offset_from_below) {
+            unbounded_below = true;
+            lower_idx = 0;
+            upper_idx = n_samples_2 - 1;
+        } else if (size - k < offset_from_below) {
+            unbounded_above = true;
+            lower_idx = n_samples - n_samples_2;
+            upper_idx = n_samples - 1;
+        } else {
+            size_t expected_idx = (k - offset_from_below) / proportion;
+            lower_idx = expected_idx < n_samples_2 / 2 ? 0 : expected_idx - n_samples_2 / 2;
+            upper_idx = std::min(n_samples - 1, lower_idx + n_samples_2 - 1);
+            lower_idx = upper_idx + 1 - n_samples_2;
+        }
+
+        // an unbounded side of the band ends at the bound of the band which it narrows, if any
+        bound outer_lower = { false, element_t() }, outer_upper = { false, element_t() };
+        size_t width = n_samples_2;
+        bool first = true;
+        while (true) {
+            bound lower = unbounded_below ? outer_lower : bound { true, _sample[lower_idx] };
+            bound upper = unbounded_above ? outer_upper : bound { true, _sample[upper_idx] };
+            counts c = count(arr, lower, upper);
+
+            if (k < c.n_less_lower || k >= size - c.n_greater_upper) {
+                _misses += first;
+                first = false;
+                ++_widenings;
+                // move the band to the side containing k, twice as wide each time,
+                // keeping the old bound inclusive, as the elements equal to it may be on either side
+                width *= 2;
+                if (k < c.n_less_lower) {
+                    upper_idx = lower_idx;
+                    unbounded_above = false;
+                    unbounded_below = lower_idx < width;
+                    lower_idx = unbounded_below ? 0 : lower_idx - width;
+                } else {
+                    lower_idx = upper_idx;
+                    unbounded_below = false;
+                    unbounded_above = _sample.size() - upper_idx <= width;
+                    upper_idx = unbounded_above ? _sample.size() - 1 : upper_idx + width;
+                }
+                continue;
+            }
+            _hits += first;
+            first = false;
+
+            const size_t strict_begin = c.n_less_lower + c.n_equal_lower;
+            const size_t strict_end = size - c.n_greater_upper - c.n_equal_upper;
+            if (k < strict_begin) {
+                ++_counted;
+                return lower.value;
+            } else if (k >= strict_end) {
+                ++_counted;
+                return upper.value;
+            }
+            const size_t n_strict = strict_end - strict_begin, rank = k - strict_begin;
+
+            if (n_strict <= _max_band_size) {
+                // reserved exactly and appended to, so that nothing more is allocated or initialized
+                if (_buffer.capacity() < n_strict) {
+                    std::vector<element_t>().swap(_buffer);
+                    _buffer.reserve(n_strict);
+                }
+                _buffer.clear();
+                strictly_inside(arr, lower, upper, [&](element_t const *from, element_t const *until) {
+                    _buffer.insert(_buffer.end(), from, until);
+                });
+                assert(_buffer.size() == n_strict);
+                _n_filtered += n_strict;
+                nth_element_or_network(_buffer.data(), _buffer.data() + rank, _buffer.data() + n_strict);
+                return _buffer[rank];
+            }
+
+            // a new sample, of every step-th element strictly inside the band, and a band of it around k;
+            // it is less than half of the sample wide, so that at least one of its bounds is from the sample
+            // and the band shrinks
+            ++_narrowings;
+            outer_lower = lower;
+            outer_upper = upper;
+            const size_t step = std::max<size_t>(1, n_strict / n_samples);
+            size_t position = 0;
+            _sample.clear();
+            strictly_inside(arr, lower, upper, [&](element_t const *from, element_t const *until) {
+                for (size_t i = (step - position % step) % step; i < size_t(until - from); i += step) {
+                    _sample.push_back(from[i]);
+                }
+                position += until - from;
+            });
+            std::sort(_sample.begin(), _sample.end());
+            const size_t expected_idx = std::min(rank / step, _sample.size() - 1);
+            const size_t half = std::min(n_samples_2 / 2, (_sample.size() - 1) / 4);
+            unbounded_below = expected_idx < half;
+            lower_idx = unbounded_below ? 0 : expected_idx - half;
+            unbounded_above = expected_idx + half >= _sample.size();
+            upper_idx = unbounded_above ? _sample.size() - 1 : expected_idx + half;
+            width = std::max<size_t>(1, 2 * half);
+        }
+    }
+};
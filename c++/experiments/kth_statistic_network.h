@@ -0,0 +1,165 @@
+#pragma once
+
+/*
+ * Sorting networks for tiny arrays, up to max_network_size elements.
+ *
+ * The networks are Batcher's odd-even merge sorts, generated at compile time for every size:
+ * the comparators of the network for the next power of two which touch only the first n positions,
+ * which is enough, as the missing positions would hold the greatest elements and never move.
+ * The network is then unrolled into a fixed sequence of compare-exchanges on a local copy of the array,
+ * without loops and branches: every compare-exchange is a comparison and two conditional moves or blends.
+ * So a tiny array costs the same whatever its order is, which is where the loops of the selection algorithms
+ * lose most of their time to the mispredicted branches and the overhead of setting them up.
+ *
+ * A sorted array is also partitioned around every k, so network_sort serves both find and partition_at,
+ * and the engines use it for tiny inputs and for the last, tiny ranges of their recursions.
+ * network_kth_statistic is the networks alone, for the arrays up to max_network_size, and std::nth_element above it.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <limits>
+#include <utility>
+
+#include "kth_statistic.h"
+
+constexpr size_t max_network_size = 32;
+
+// The networks are only used for numbers: larger elements are costly to keep in a local copy and to move conditionally
+template<typename element_t>
+constexpr bool uses_networks = std::is_arithmetic_v<element_t>;
+
+namespace sorting_network_detail {
+
+struct comparator {
+    uint8_t low, high;
+};
+
+// Calls f(low, high) for every comparator of the odd-even merge sort of n elements, in order
+template<typename visitor_t>
+constexpr void odd_even_merge_sort(size_t n, visitor_t f) {
+    for (size_t p = 1; p < n; p += p) {
+        for (size_t k = p; k > 0; k /= 2) {
+            for (size_t j = k % p; j + k < n; j += k + k) {
+                for (size_t i = 0; i < k && i + j + k < n; ++i) {
+                    if ((i + j) / (p + p) == (i + j + k) / (p + p)) {
+                        f(i + j, i + j + k);
+                    }
+                }
+            }
+        }
+    }
+}
+
+constexpr size_t n_comparators(size_t n) {
+    size_t count = 0;
+    odd_even_merge_sort(n, [&count](size_t, size_t) { ++count; });
+    return count;
+}
+
+template<size_t n>
+constexpr std::array<comparator, n_comparators(n)> comparators() {
+    std::array<comparator, n_comparators(n)> result {};
+    size_t count = 0;
+    odd_even_merge_sort(n, [&](size_t low, size_t high) {
+        result[count++] = { uint8_t(low), uint8_t(high) };
+    });
+    return result;
+}
+
+template<size_t n>
+constexpr std::array<comparator, n_comparators(n)> network = comparators<n>();
+
+// Not std::min and std::max in general, which return their first argument for equal ones, and would thus
+// duplicate it, which matters for the elements that are equal by their keys only
+template<typename element_t>
+inline void compare_exchange(element_t &a, element_t &b) {
+    if constexpr (std::is_floating_point_v<element_t>) {
+        // separate selects, which become a minsd and a maxsd rather than a branch; equal numbers differ
+        // only by the sign of zero, which may be lost then
+        element_t low = b < a ? b : a;
+        element_t high = a < b ? b : a;
+        a = low;
+        b = high;
+    } else {
+        bool swap = b < a;
+        element_t low = swap ? b : a;
+        b = swap ? a : b;
+        a = low;
+    }
+}
+
+template<typename element_t, size_t n, size_t... idx>
+inline void run(element_t *v, std::index_sequence<idx...>) {
+    (compare_exchange(v[network<n>[idx].low], v[network<n>[idx].high]), ...);
+}
+
+template<typename element_t, size_t n>
+void sort(element_t *arr) {
+    // a local copy, which the compiler keeps in registers, as all the indices are known
+    element_t v[n > 0 ? n : 1];
+    for (size_t i = 0; i < n; ++i) {
+        v[i] = arr[i];
+    }
+    run<element_t, n>(v, std::make_index_sequence<network<n>.size()>());
+    for (size_t i = 0; i < n; ++i) {
+        arr[i] = v[i];
+    }
+}
+
+template<typename element_t, size_t... sizes>
+constexpr std::array<void (*)(element_t *), sizeof...(sizes)> make_table(std::index_sequence<sizes...>) {
+    return { &sort<element_t, sizes>... };
+}
+
+template<typename element_t>
+constexpr std::array<void (*)(element_t *), max_network_size + 1> table =
+    make_table<element_t>(std::make_index_sequence<max_network_size + 1>());
+
+}
+
+// Sorts arr[0], ..., arr[n - 1], where n <= max_network_size
+template<typename element_t>
+inline void network_sort(element_t *arr, size_t n) {
+    sorting_network_detail::table<element_t>[n](arr);
+}
+
+// The number of compare-exchanges of the network for n elements
+constexpr size_t network_size(size_t n) {
+    return sorting_network_detail::n_comparators(n);
+}
+
+// std::nth_element, which sorts the tiny ranges with the networks instead
+template<typename element_t>
+inline void nth_element_or_network(element_t *first, element_t *nth, element_t *last) {
+    if (uses_networks<element_t> && size_t(last - first) <= max_network_size) {
+        network_sort(first, size_t(last - first));
+    } else {
+        std::nth_element(first, nth, last);
+    }
+}
+
+template<typename element_t>
+struct network_kth_statistic : kth_statistic<element_t> {
+    char const *name() const { return "sorting network, then std::nth_element"; }
+    bool is_inplace() const { return true; }
+    bool is_destructive() const { return false; }
+    size_t size() { return std::numeric_limits<size_t>::max(); }
+    void resize(size_t new_size) {}
+
+    element_t find(element_t *start, size_t size, size_t k) {
+        partition_at(start, size, k);
+        return start[k];
+    }
+
+    void partition_at(element_t *start, size_t size, size_t k) {
+        if (size <= max_network_size) {
+            network_sort(start, size);
+        } else {
+            std::nth_element(start, start + k, start + size);
+        }
+    }
+};
@@ -0,0 +1,161 @@
+#pragma once
+
+/*
+ * The argselect version of predicting_kth_statistic.
+ *
+ * The sample and the band around k are chosen from the keys exactly as predicting_kth_statistic does.
+ * The filtering pass reads only the key column, and copies the keys of the band
+ * together with their indices to the aux array, so the records themselves are never touched.
+ * The (key, index) pairs of the band are then processed with std::nth_element by key.
+ *
+ * If k is not in the band, the keys on the side of the band which contains k
+ * are filtered in the same way, which always succeeds.
+ *
+ * Both aux arrays, the band and the sample, are taken from one workspace, one after the other.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <type_traits>
+
+#include "kth_statistic_argselect.h"
+#include "kth_statistic_predictor_simple.h"
+
+template<typename key_t, sample_size_policy sizes_t = sample_sizes>
+struct predicting_argselect : kth_argselect<key_t> {
+private:
+    size_t _size;
+    char const *_name;
+    workspace *_workspace;
+    bool _owns_workspace;
+    key_t *_sample;
+    keyed_index<key_t> *_band;
+    size_t _hits, _misses, _phase_2_samples;
+    std::conditional_t<std::is_polymorphic_v<sizes_t>, sizes_t &, sizes_t> _sample_sizes;
+
+    // Copies (key, index) for all keys such that lower <= key <= upper, where only the enabled bounds are checked.
+    // Returns the number of copied keys, and adds the number of keys less than lower to n_less.
+    template<bool has_lower, bool has_upper>
+    size_t filter(key_t const *keys, size_t size, key_t lower, key_t upper, size_t &n_less) {
+        keyed_index<key_t> *dest = _band;
+        size_t count_less = 0;
+        for (size_t i = 0; i < size; ++i) {
+            key_t key = keys[i];
+            dest->key = key;
+            dest->index = i;
+            bool is_lower = has_lower && key < lower;
+            bool is_good = !is_lower && (!has_upper || key <= upper);
+            count_less += is_lower;
+            dest += is_good;
+        }
+        n_less += count_less;
+        return dest - _band;
+    }
+
+    void acquire(size_t size) {
+        typedef keyed_index<key_t> band_t;
+        size_t sample_in_band_units = (size * sizeof(key_t) + sizeof(band_t) - 1) / sizeof(band_t);
+        _band = _workspace->get<band_t>(size + sample_in_band_units);
+        _sample = reinterpret_cast<key_t *>(_band + size);
+    }
+
+    size_t select_in_band(size_t n_band, size_t k) {
+        std::nth_element(_band, _band + k, _band + n_band);
+        return _band[k].index;
+    }
+
+public:
+    char const *name() const { return _name; }
+    size_t size() { return _size; }
+
+    predicting_argselect(sizes_t &sample_sizes, char const *name, size_t initial_size = 1,
+                         workspace *shared_workspace = nullptr)
+    : _size(initial_size), _name(name),
+      _workspace(shared_workspace != nullptr ? shared_workspace : new workspace()),
+      _owns_workspace(shared_workspace == nullptr),
+      _hits(0), _misses(0), _phase_2_samples(0), _sample_sizes(sample_sizes) {
+        acquire(_size);
+    }
+
+    void resize(size_t new_size) {
+        _size = new_size;
+        acquire(_size);
+    }
+
+    ~predicting_argselect() {
+        if (_owns_workspace) {
+            delete _workspace;
+        }
+    }
+
+    void display_and_reset_statistics(std::ostream &out) {
+        out << "    [Hits: " << _hits
+            << ", misses: " << _misses
+            << ", phase 2 samples avg: " << double(_phase_2_samples) / _hits
+            << "]" << std::endl;
+        _hits = 0;
+        _misses = 0;
+        _phase_2_samples = 0;
+    }
+
+    size_t find_index(key_t const *keys, size_t size, size_t k) {
+        acquire(size);
+        size_t n_less = 0;
+        if (!_sample_sizes.is_size_acceptable(size)) {
+            return select_in_band(filter<false, false>(keys, size, key_t(), key_t(), n_less), k);
+        }
+
+        const size_t n_samples = _sample_sizes.n_phase_1_samples(size);
+        const size_t proportion = size / n_samples;
+        const size_t offset_from_below = (size - (n_samples - 1) * proportion + 1) / 2;
+
+        for (size_t i = 0, j = offset_from_below; i < n_samples; ++i, j += proportion) {
+            assert(j < size);
+            _sample[i] = keys[j];
+        }
+
+        const size_t n_samples_2 = _sample_sizes.n_phase_2_samples(size, n_samples);
+        assert(n_samples_2 <= n_samples);
+
+        key_t lower = key_t(), upper = key_t();
+        size_t n_band;
+        if (k < offset_from_below) {
+            std::nth_element(_sample, _sample + n_samples_2 - 1, _sample + n_samples);
+            upper = _sample[n_samples_2 - 1];
+            n_band = filter<false, true>(keys, size, lower, upper, n_less);
+        } else if (size - k < offset_from_below) {
+            std::nth_element(_sample, _sample + n_samples - n_samples_2, _sample + n_samples);
+            lower = _sample[n_samples - n_samples_2];
+            n_band = filter<true, false>(keys, size, lower, upper, n_less);
+        } else {
+            size_t expected_idx = (k - offset_from_below) / proportion;
+            size_t lower_idx = expected_idx < n_samples_2 / 2 ? 0 : expected_idx - n_samples_2 / 2;
+            size_t upper_idx = std::min(n_samples - 1, lower_idx + n_samples_2 - 1);
+            lower_idx = upper_idx + 1 - n_samples_2;
+            std::nth_element(_sample, _sample + lower_idx, _sample + n_samples);
+            std::nth_element(_sample + lower_idx + 1, _sample + upper_idx, _sample + n_samples);
+            lower = _sample[lower_idx];
+            upper = _sample[upper_idx];
+            n_band = filter<true, true>(keys, size, lower, upper, n_less);
+        }
+
+        if (k >= n_less && k - n_less < n_band) {
+            ++_hits;
+            _phase_2_samples += n_band;
+            return select_in_band(n_band, k - n_less);
+        }
+
+        ++_misses;
+        if (k < n_less) {
+            // everything not greater than the lower bound
+            size_t n_side = filter<false, true>(keys, size, key_t(), lower, n_less);
+            return select_in_band(n_side, k);
+        } else {
+            // everything not less than the upper bound
+            size_t n_side_less = 0;
+            size_t n_side = filter<true, false>(keys, size, upper, key_t(), n_side_less);
+            return select_in_band(n_side, k - n_side_less);
+        }
+    }
+};
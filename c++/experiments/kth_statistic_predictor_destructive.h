@@ -0,0 +1,255 @@
+#pragma once
+
+/*
+ * The destructive version of predicting_kth_statistic, which needs no aux array of the size of the input.
+ *
+ * The sample and the band around k are chosen exactly as predicting_kth_statistic does,
+ * but the filtering pass compacts the band into the front of the array itself, using the same kernels,
+ * which allow the destination to lie before the source. So the array is destroyed, and only the sample
+ * and the prefix of the array which the band may overwrite are kept in the aux memory.
+ * The prefix is copied before the pass, and it is only needed if the prediction fails: then it is copied back,
+ * which restores the array exactly, as nothing past the prefix is ever written. Then the array is split in place
+ * into the elements below the band, in the band and above it, and k is selected in the part which contains it.
+ * The pass is done in steps which cannot write past the prefix. If the band turns out to be larger than that,
+ * which happens with many equal elements, the array is restored and the band is counted first,
+ * and it is compacted without a limit if it contains k.
+ *
+ * The prefix is twice the expected size of the band, so the aux memory is proportional to the sample
+ * and the band, which are both much smaller than the array, rather than to the array itself.
+ * It also stays in the cache while the pass streams over the array, and the band is then selected in place.
+ *
+ * The multi-k queries are done with the default implementation, which works in place anyway.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <limits>
+#include <type_traits>
+
+#include "kth_statistic.h"
+#include "kth_statistic_filters.h"
+#include "kth_statistic_hoare.h"
+#include "kth_statistic_network.h"
+#include "kth_statistic_predictor_simple.h"
+#include "workspace.h"
+
+template<typename element_t, sample_size_policy sizes_t = sample_sizes>
+struct destructive_predicting_kth_statistic : kth_statistic<element_t> {
+private:
+    // the prefix which may be overwritten, in expected sizes of the band
+    static constexpr size_t band_slack = 2;
+    // the steps of the pass are never shorter than this, unless they reach the end of the array
+    static constexpr size_t min_step = 256;
+
+    char const *_name;
+    workspace *_workspace;
+    bool _owns_workspace;
+    // the overflows of the band into the saved prefix, which end in hits as well as in misses
+    size_t _hits, _misses, _overflows;
+    size_t _phase_1_samples, _phase_2_samples, _prefix_size;
+    // virtual sample sizes are shared, policies are copied
+    std::conditional_t<std::is_polymorphic_v<sizes_t>, sizes_t &, sizes_t> _sample_sizes;
+
+    // Tells the sample sizes how the prediction went, if they want to know
+    void feedback(size_t size, size_t n_samples, size_t n_samples_2, size_t band_size, bool hit) {
+        if constexpr (requires { _sample_sizes.feedback(size, n_samples, n_samples_2, band_size, hit); }) {
+            _sample_sizes.feedback(size, n_samples, n_samples_2, band_size, hit);
+        }
+    }
+
+    // Compacts the elements x such that lower <= x <= upper, where only the enabled bounds are checked,
+    // into the front of the array, in steps which never write past start + limit.
+    // Returns the end of the compacted elements, or nullptr if they would not fit,
+    // and sets n_less to the number of elements x < lower.
+    static element_t *compact(element_t *start, size_t size, size_t limit,
+                              bool has_lower, element_t lower, bool has_upper, element_t upper, size_t &n_less) {
+        filter_kernel_set<element_t> const &filters = filter_kernels<element_t>();
+        element_t *dest = start, *from = start, *until = start + size;
+        n_less = 0;
+        while (from < until) {
+            size_t room = limit - size_t(dest - start);
+            size_t step = std::min(room, size_t(until - from));
+            if (step < min_step && step < size_t(until - from)) {
+                return nullptr;
+            }
+            if (!has_lower) {
+                dest = filters.not_greater(from, from + step, upper, dest);
+            } else if (!has_upper) {
+                dest = filters.not_less(from, from + step, lower, dest);
+            } else {
+                dest = filters.between(from, from + step, lower, upper, dest, n_less);
+            }
+            from += step;
+        }
+        if (has_lower && !has_upper) {
+            n_less = size - (dest - start);
+        }
+        return dest;
+    }
+
+    // Splits the array in place into the elements below lower, between the bounds, and above upper,
+    // where only the enabled bounds are checked, and selects k in the part which contains it
+    static element_t split(element_t *start, size_t size, size_t k,
+                           bool has_lower, element_t lower, bool has_upper, element_t upper) {
+        element_t *from = start, *until = start + size;
+        if (has_lower) {
+            element_t *middle = std::partition(from, until, [lower](element_t const &x) { return x < lower; });
+            if (start + k < middle) {
+                until = middle;
+            } else {
+                from = middle;
+            }
+        }
+        if (has_upper && from != until) {
+            element_t *middle = std::partition(from, until, [upper](element_t const &x) { return !(upper < x); });
+            if (start + k < middle) {
+                until = middle;
+            } else {
+                from = middle;
+            }
+        }
+        introspective_select<element_t>::select(from, until - 1, start + k,
+                                                introspective_select<element_t>::default_budget_factor);
+        return start[k];
+    }
+
+public:
+    char const *name() const { return _name; }
+    bool is_inplace() const { return false; }
+    bool is_destructive() const { return true; }
+    // the aux memory depends only on the sample sizes, so it is taken on every call, and any size is fine
+    size_t size() { return std::numeric_limits<size_t>::max(); }
+    void resize(size_t new_size) {}
+
+    destructive_predicting_kth_statistic(sizes_t &sample_sizes,
+                                         const char *name,
+                                         workspace *shared_workspace = nullptr)
+    : _name(name),
+      _workspace(shared_workspace != nullptr ? shared_workspace : new workspace()),
+      _owns_workspace(shared_workspace == nullptr),
+      _hits(0), _misses(0), _overflows(0),
+      _phase_1_samples(0), _phase_2_samples(0), _prefix_size(0),
+      _sample_sizes(sample_sizes) {}
+
+    ~destructive_predicting_kth_statistic() {
+        if (_owns_workspace) {
+            delete _workspace;
+        }
+    }
+
+    void display_and_reset_statistics(std::ostream &out) {
+        size_t predicted = _hits + _misses;
+        out << "    [Hits: " << _hits
+            << ", misses: " << _misses
+            << ", band overflows: " << _overflows
+            << ", phase 1 samples avg: " << double(_phase_1_samples) / predicted
+            << ", phase 2 samples avg: " << double(_phase_2_samples) / _hits
+            << ", saved prefix avg: " << double(_prefix_size) / predicted
+            << "]" << std::endl;
+        _hits = 0;
+        _misses = 0;
+        _overflows = 0;
+        _phase_1_samples = 0;
+        _phase_2_samples = 0;
+        _prefix_size = 0;
+    }
+
+    element_t find(element_t *start, size_t size, size_t k) final {
+        // a network sorts the tiny arrays faster than any prediction could help
+        if (!_sample_sizes.is_size_acceptable(size) || (uses_networks<element_t> && size <= max_network_size)) {
+            nth_element_or_network(start, start + k, start + size);
+            return start[k];
+        }
+
+        const size_t n_samples = _sample_sizes.n_phase_1_samples(size);
+        const size_t proportion = size / n_samples;
+        const size_t offset_from_below = (size - (n_samples - 1) * proportion + 1) / 2;
+        const size_t n_samples_2 = _sample_sizes.n_phase_2_samples(size, n_samples);
+        assert(n_samples_2 <= n_samples);
+        const size_t prefix = std::min(size, band_slack * n_samples_2 * proportion + min_step);
+
+        element_t *mem = _workspace->get<element_t>(std::max(n_samples, prefix));
+        for (size_t i = 0, j = offset_from_below; i < n_samples; ++i, j += proportion) {
+            assert(j < size);
+            mem[i] = start[j];
+        }
+        _phase_1_samples += n_samples;
+
+        // the band of the sample, which is unbounded on the side of k if k is beyond the sample
+        bool has_lower = k >= offset_from_below, has_upper = size - k >= offset_from_below;
+        size_t lower_idx, upper_idx;
+        if (!has_lower) {
+            lower_idx = 0;
+            upper_idx = n_samples_2 - 1;
+        } else if (!has_upper) {
+            lower_idx = n_samples - n_samples_2;
+            upper_idx = n_samples - 1;
+        } else {
+            size_t expected_idx = (k - offset_from_below) / proportion;
+            lower_idx = expected_idx < n_samples_2 / 2 ? 0 : expected_idx - n_samples_2 / 2;
+            upper_idx = lower_idx + n_samples_2 - 1;
+            if (upper_idx >= n_samples) {
+                upper_idx = n_samples - 1;
+                lower_idx = upper_idx - n_samples_2 + 1;
+            }
+        }
+        nth_element_or_network(mem, mem + lower_idx, mem + n_samples);
+        nth_element_or_network(mem + lower_idx + 1, mem + upper_idx, mem + n_samples);
+        element_t lower = mem[lower_idx], upper = mem[upper_idx];
+
+        filter_kernel_set<element_t> const &filters = filter_kernels<element_t>();
+        if (has_lower && has_upper && lower == upper) {
+            // nothing to compact, and nothing is destroyed
+            size_t count_less = 0, count_equal = 0;
+            filters.count_less_equal(start, start + size, lower, count_less, count_equal);
+            bool hit = k >= count_less && k < count_less + count_equal;
+            feedback(size, n_samples, n_samples_2, count_equal, hit);
+            if (hit) {
+                ++_hits;
+                return lower;
+            }
+            ++_misses;
+            return split(start, size, k, true, lower, true, upper);
+        }
+
+        std::copy(start, start + prefix, mem);
+        _prefix_size += prefix;
+        size_t n_less;
+        element_t *band_end = compact(start, size, prefix, has_lower, lower, has_upper, upper, n_less);
+        if (band_end == nullptr) {
+            // the array is restored, and only if k is in the band, which is large, it is compacted without a limit
+            ++_overflows;
+            std::copy(mem, mem + prefix, start);
+            size_t count_less = 0, count_lower = 0, count_below_upper = 0, count_upper = 0;
+            if (has_lower) {
+                filters.count_less_equal(start, start + size, lower, count_less, count_lower);
+            }
+            size_t count_not_greater = size;
+            if (has_upper) {
+                filters.count_less_equal(start, start + size, upper, count_below_upper, count_upper);
+                count_not_greater = count_below_upper + count_upper;
+            }
+            if (k >= count_less && k < count_not_greater) {
+                band_end = compact(start, size, size, has_lower, lower, has_upper, upper, n_less);
+            } else {
+                ++_misses;
+                feedback(size, n_samples, n_samples_2, count_not_greater - count_less, false);
+                return split(start, size, k, has_lower, lower, has_upper, upper);
+            }
+        }
+
+        size_t n_band = band_end - start;
+        bool hit = k >= n_less && k - n_less < n_band;
+        feedback(size, n_samples, n_samples_2, n_band, hit);
+        if (hit) {
+            ++_hits;
+            _phase_2_samples += n_band;
+            nth_element_or_network(start, start + (k - n_less), band_end);
+            return start[k - n_less];
+        }
+        ++_misses;
+        std::copy(mem, mem + prefix, start);
+        return split(start, size, k, has_lower, lower, has_upper, upper);
+    }
+};
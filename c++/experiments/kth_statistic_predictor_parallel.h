@@ -0,0 +1,236 @@
+#pragma once
+
+/*
+ * A multi-threaded version of predicting_kth_statistic.
+ *
+ * The array is split into one slice per task. Both the phase-1 sampling
+ * and the filtering pass are done in parallel, each slice being filtered
+ * into its own part of the aux array, so that no synchronization is needed.
+ * Afterwards, the prefix sums of the filtered sizes tell where every filtered slice
+ * should go, and the slices are compacted to the beginning of the aux array,
+ * where the final std::nth_element takes place.
+ *
+ * Arrays which are too small to give every thread a reasonable amount of work
+ * are processed with fewer tasks, down to a single one, which runs on the calling thread.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+#include "kth_statistic.h"
+#include "kth_statistic_filters.h"
+#include "kth_statistic_network.h"
+#include "kth_statistic_predictor_simple.h"
+#include "thread_pool.h"
+
+template<typename element_t>
+struct parallel_predicting_kth_statistic : kth_statistic<element_t> {
+private:
+    static constexpr size_t min_elements_per_task = size_t(1) << 16;
+    // the strided gather of phase 1 costs a cache miss per sample, so far smaller samples are worth splitting
+    static constexpr size_t min_samples_per_task = size_t(1) << 12;
+
+    size_t _size;
+    char const *_name;
+    workspace *_workspace;
+    bool _owns_workspace;
+    // the memory of the workspace for the current call
+    element_t *_mem;
+    size_t _hits, _misses;
+    size_t _phase_1_samples, _phase_2_samples;
+    size_t _parallel_calls;
+    sample_sizes &_sample_sizes;
+    thread_pool &_pool;
+
+    struct slice_result {
+        element_t *end;
+        size_t n_less, n_equal;
+    };
+    std::vector<slice_result> _slices;
+
+    size_t n_tasks(size_t n, size_t min_per_task = min_elements_per_task) const {
+        return std::max(size_t(1), std::min(_pool.n_threads(), n / min_per_task));
+    }
+
+    static size_t slice_begin(size_t n, size_t n_tasks, size_t task) {
+        return n / n_tasks * task + std::min(task, n % n_tasks);
+    }
+
+    // Moves the filtered slices together, returns the end of the filtered elements
+    element_t *compact(size_t n, size_t tasks) {
+        element_t *mem_end = _slices[0].end;
+        for (size_t t = 1; t < tasks; ++t) {
+            element_t *slice_start = _mem + slice_begin(n, tasks, t);
+            mem_end = std::copy(slice_start, _slices[t].end, mem_end);
+        }
+        return mem_end;
+    }
+
+public:
+    char const *name() const { return _name; }
+    bool is_inplace() const { return false; }
+    bool is_destructive() const { return false; }
+    size_t size() { return _size; }
+
+    parallel_predicting_kth_statistic(sample_sizes &sample_sizes,
+                                      thread_pool &pool,
+                                      const char *name,
+                                      size_t initial_size = 1,
+                                      workspace *shared_workspace = nullptr)
+    : _size(initial_size), _name(name),
+      _workspace(shared_workspace != nullptr ? shared_workspace : new workspace()),
+      _owns_workspace(shared_workspace == nullptr),
+      _hits(0), _misses(0), _phase_1_samples(0), _phase_2_samples(0), _parallel_calls(0),
+      _sample_sizes(sample_sizes), _pool(pool), _slices(pool.n_threads()) {
+        _mem = _workspace->get<element_t>(_size);
+    }
+
+    void resize(size_t new_size) {
+        _size = new_size;
+        _mem = _workspace->get<element_t>(_size);
+    }
+
+    ~parallel_predicting_kth_statistic() {
+        if (_owns_workspace) {
+            delete _workspace;
+        }
+    }
+
+    void display_and_reset_statistics(std::ostream &out) {
+        out << "    [Hits: " << _hits
+            << ", misses: " << _misses
+            << ", phase 1 samples avg: " << double(_phase_1_samples) / (_hits + _misses)
+            << ", phase 2 samples avg: " << double(_phase_2_samples) / _hits
+            << ", multi-threaded calls: " << _parallel_calls
+            << ", threads: " << _pool.n_threads()
+            << "]" << std::endl;
+        _hits = 0;
+        _misses = 0;
+        _phase_1_samples = 0;
+        _phase_2_samples = 0;
+        _parallel_calls = 0;
+    }
+
+    element_t find(element_t *start, size_t size, size_t k) {
+        _mem = _workspace->get<element_t>(size);
+        // a network sorts the tiny arrays faster than any prediction could help
+        if (!_sample_sizes.is_size_acceptable(size) || (uses_networks<element_t> && size <= max_network_size)) {
+            nth_element_or_network(start, start + k, start + size);
+            return start[k];
+        }
+
+        const size_t n_samples = _sample_sizes.n_phase_1_samples(size);
+        const size_t proportion = size / n_samples;
+        const size_t offset_from_below = (size - (n_samples - 1) * proportion + 1) / 2;
+
+        const size_t sample_tasks = n_tasks(n_samples, min_samples_per_task);
+        _pool.run(sample_tasks, [&](size_t task) {
+            size_t i = slice_begin(n_samples, sample_tasks, task);
+            size_t i_end = slice_begin(n_samples, sample_tasks, task + 1);
+            for (size_t j = offset_from_below + i * proportion; i < i_end; ++i, j += proportion) {
+                assert(j < size);
+                _mem[i] = start[j];
+            }
+        });
+        _phase_1_samples += n_samples;
+
+        const size_t n_samples_2 = _sample_sizes.n_phase_2_samples(size, n_samples);
+        assert(n_samples_2 <= n_samples);
+
+        filter_kernel_set<element_t> const &filters = filter_kernels<element_t>();
+        const size_t tasks = n_tasks(size);
+        _parallel_calls += tasks > 1;
+
+        element_t *mem_end;
+        element_t *subsampled_k;
+
+        if (k < offset_from_below) {
+            // k-th order stat is likely <= the smallest element
+            nth_element_or_network(_mem, _mem + n_samples_2 - 1, _mem + n_samples);
+            element_t upper = _mem[n_samples_2 - 1];
+            _pool.run(tasks, [&](size_t task) {
+                size_t from = slice_begin(size, tasks, task), until = slice_begin(size, tasks, task + 1);
+                _slices[task].end = filters.not_greater(start + from, start + until, upper, _mem + from);
+            });
+            mem_end = compact(size, tasks);
+            subsampled_k = _mem + k;
+        } else if (size - k < offset_from_below) {
+            // k-th order stat is likely >= the greatest element
+            nth_element_or_network(_mem, _mem + n_samples - n_samples_2, _mem + n_samples);
+            element_t lower = _mem[n_samples - n_samples_2];
+            _pool.run(tasks, [&](size_t task) {
+                size_t from = slice_begin(size, tasks, task), until = slice_begin(size, tasks, task + 1);
+                _slices[task].end = filters.not_less(start + from, start + until, lower, _mem + from);
+            });
+            mem_end = compact(size, tasks);
+            subsampled_k = mem_end - (size - k);
+        } else {
+            element_t *expected_idx = _mem + (k - offset_from_below) / proportion;
+            element_t *lower_idx = expected_idx - n_samples_2 / 2;
+            element_t *higher_idx = lower_idx + n_samples_2 - 1;
+            if (lower_idx < _mem) {
+                lower_idx = _mem;
+                higher_idx = _mem + n_samples_2 - 1;
+            }
+            if (higher_idx >= _mem + n_samples) {
+                higher_idx = _mem + n_samples - 1;
+                lower_idx = higher_idx - n_samples_2 + 1;
+            }
+            assert(lower_idx >= _mem);
+            nth_element_or_network(_mem, lower_idx, _mem + n_samples);
+            nth_element_or_network(lower_idx + 1, higher_idx, _mem + n_samples);
+
+            element_t lower = *lower_idx;
+            element_t upper = *higher_idx;
+
+            if (lower == upper) {
+                _pool.run(tasks, [&](size_t task) {
+                    size_t from = slice_begin(size, tasks, task), until = slice_begin(size, tasks, task + 1);
+                    _slices[task].n_less = 0;
+                    _slices[task].n_equal = 0;
+                    filters.count_less_equal(start + from, start + until, lower,
+                                             _slices[task].n_less, _slices[task].n_equal);
+                });
+                size_t count_less = 0, count_eq = 0;
+                for (size_t t = 0; t < tasks; ++t) {
+                    count_less += _slices[t].n_less;
+                    count_eq += _slices[t].n_equal;
+                }
+                if (k >= count_less && k < count_less + count_eq) {
+                    ++_hits;
+                    _sample_sizes.feedback(size, n_samples, n_samples_2, count_eq, true);
+                    return lower;
+                }
+                mem_end = _mem;
+                subsampled_k = _mem - 1;
+            } else {
+                _pool.run(tasks, [&](size_t task) {
+                    size_t from = slice_begin(size, tasks, task), until = slice_begin(size, tasks, task + 1);
+                    _slices[task].n_less = 0;
+                    _slices[task].end = filters.between(start + from, start + until, lower, upper,
+                                                        _mem + from, _slices[task].n_less);
+                });
+                size_t count_less = 0;
+                for (size_t t = 0; t < tasks; ++t) {
+                    count_less += _slices[t].n_less;
+                }
+                mem_end = compact(size, tasks);
+                subsampled_k = k >= count_less ? _mem + (k - count_less) : _mem - 1;
+            }
+        }
+
+        if (subsampled_k >= _mem && subsampled_k < mem_end) {
+            ++_hits;
+            _phase_2_samples += mem_end - _mem;
+            _sample_sizes.feedback(size, n_samples, n_samples_2, mem_end - _mem, true);
+            nth_element_or_network(_mem, subsampled_k, mem_end);
+            return *subsampled_k;
+        } else {
+            ++_misses;
+            _sample_sizes.feedback(size, n_samples, n_samples_2, mem_end - _mem, false);
+            nth_element_or_network(start, start + k, start + size);
+            return start[k];
+        }
+    }
+};
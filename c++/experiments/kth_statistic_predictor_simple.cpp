@@ -1,4 +1,8 @@
 #include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
 #include <utility>
 #include <vector>
 #include "kth_statistic_predictor_simple.h"
@@ -26,55 +30,202 @@ size_t fixed_ratio_sample_sizes::n_phase_2_samples(size_t n, size_t phase_1) {
 // tuned_ratio_sample_sizes //
 //////////////////////////////
 
-struct precalc_double_power {
-    const double lo_power, lo_mult, hi_power, hi_mult;
-    const size_t lo_max, hi_min;
-
-    std::vector<double> precalc;
-    precalc_double_power(double lo_power, double lo_mult, size_t lo_max,
-                         double hi_power, double hi_mult, size_t hi_min)
-      : lo_power(lo_power), lo_mult(lo_mult)
-      , hi_power(hi_power), hi_mult(hi_mult)
-      , lo_max(lo_max), hi_min(hi_min)
-      , precalc(hi_min + 1) {
-        for (size_t n = 1; n <= lo_max; ++n) {
-            precalc[n] = pow(n, lo_power) * lo_mult;
-        }
-        precalc[hi_min] = pow(hi_min, hi_power) * hi_mult;
-        double log_lo_max = log(lo_max);
-        double log_hi_min = log(hi_min);
-        double log_lo_val = log(precalc[lo_max]);
-        double log_hi_val = log(precalc[hi_min]);
-        for (size_t n = lo_max + 1; n < hi_min; ++n) {
-            double x = (log(n) - log_lo_max) / (log_hi_min - log_lo_max);
-            double y = log_lo_val + x * (log_hi_val - log_lo_val);
-            precalc[n] = exp(y);
-        }
+tuned_ratio_sample_sizes::tuned_ratio_sample_sizes() {}
+
+bool tuned_ratio_sample_sizes::is_size_acceptable(size_t n) {
+    return tuned_ratio_policy::is_size_acceptable(n);
+}
+
+size_t tuned_ratio_sample_sizes::n_phase_1_samples(size_t n) {
+    return tuned_ratio_policy::n_phase_1_samples(n);
+}
+
+size_t tuned_ratio_sample_sizes::n_phase_2_samples(size_t n, size_t phase_1) {
+    return tuned_ratio_policy::n_phase_2_samples(n, phase_1);
+}
+
+///////////////////////////
+// profiled_sample_sizes //
+///////////////////////////
+
+profiled_sample_sizes::profiled_sample_sizes(): _min_size(0) {}
+
+bool profiled_sample_sizes::is_size_acceptable(size_t n) {
+    return is_profiled() ? n >= _min_size : tuned_ratio_policy::is_size_acceptable(n);
+}
+
+size_t profiled_sample_sizes::n_phase_1_samples(size_t n) {
+    if (!is_profiled()) {
+        return tuned_ratio_policy::n_phase_1_samples(n);
+    }
+    double phase_1_divisor, phase_2_divisor;
+    divisors(n, phase_1_divisor, phase_2_divisor);
+    return std::max(size_t(1), size_t(n / phase_1_divisor));
+}
+
+size_t profiled_sample_sizes::n_phase_2_samples(size_t n, size_t phase_1) {
+    if (!is_profiled()) {
+        return tuned_ratio_policy::n_phase_2_samples(n, phase_1);
+    }
+    double phase_1_divisor, phase_2_divisor;
+    divisors(n, phase_1_divisor, phase_2_divisor);
+    return std::min(phase_1, 1 + size_t(n / phase_2_divisor));
+}
+
+void profiled_sample_sizes::divisors(size_t n, double &phase_1_divisor, double &phase_2_divisor) const {
+    if (n < n_tabulated) {
+        phase_1_divisor = _phase_1_table[n];
+        phase_2_divisor = _phase_2_table[n];
+    } else {
+        interpolate(n, phase_1_divisor, phase_2_divisor);
+    }
+}
+
+void profiled_sample_sizes::interpolate(size_t n, double &phase_1_divisor, double &phase_2_divisor) const {
+    size_t next = 0;
+    while (next < _points.size() && _points[next].n < n) {
+        ++next;
+    }
+    if (next == 0) {
+        phase_1_divisor = _points[0].phase_1_divisor;
+        phase_2_divisor = _points[0].phase_2_divisor;
+        return;
     }
+    if (next == _points.size()) {
+        point const &p = _points.back();
+        phase_1_divisor = p.phase_1_divisor * (guess_y.value(n) / guess_y.value(p.n));
+        phase_2_divisor = p.phase_2_divisor * (guess_x.value(n) / guess_x.value(p.n));
+        return;
+    }
+    point const &lo = _points[next - 1], &hi = _points[next];
+    double x = std::log(double(n) / lo.n) / std::log(double(hi.n) / lo.n);
+    phase_1_divisor = lo.phase_1_divisor * std::pow(hi.phase_1_divisor / lo.phase_1_divisor, x);
+    phase_2_divisor = lo.phase_2_divisor * std::pow(hi.phase_2_divisor / lo.phase_2_divisor, x);
+}
 
-    double value(size_t n) const {
-        if (n < precalc.size()) {
-            return precalc[n];
+void profiled_sample_sizes::set(size_t min_size, std::vector<point> const &points) {
+    _min_size = std::max(size_t(2), min_size);
+    _points = points;
+    _phase_1_table.assign(n_tabulated, 1);
+    _phase_2_table.assign(n_tabulated, 1);
+    if (_points.empty()) {
+        return;
+    }
+    for (size_t n = 1; n < n_tabulated; ++n) {
+        interpolate(n, _phase_1_table[n], _phase_2_table[n]);
+    }
+}
+
+bool profiled_sample_sizes::load(char const *path) {
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    size_t min_size = 0;
+    std::vector<point> points;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string key;
+        if (!(fields >> key) || key[0] == '#') {
+            continue;
+        }
+        if (key == "min_size") {
+            if (!(fields >> min_size)) {
+                return false;
+            }
+        } else if (key == "point") {
+            point p;
+            if (!(fields >> p.n >> p.phase_1_divisor >> p.phase_2_divisor)
+                || p.n == 0 || !(p.phase_1_divisor >= 1) || !(p.phase_2_divisor >= 1)
+                || (!points.empty() && points.back().n >= p.n)) {
+                return false;
+            }
+            points.push_back(p);
         } else {
-            return pow(n, hi_power) * hi_mult;
+            return false;
         }
     }
-};
+    if (points.empty()) {
+        return false;
+    }
+    set(min_size, points);
+    return true;
+}
 
-const precalc_double_power guess_x(0.9, 0.63, 100,  0.58, 1.29, 1000);
-const precalc_double_power guess_y(0.8, 0.63, 100,  1.0 / 3, 1.3, 1000);
+bool profiled_sample_sizes::save(char const *path) const {
+    std::ofstream out(path);
+    out << "# Sample sizes of predicting_kth_statistic, for profiled_sample_sizes\n"
+        << "# point <n> <n / phase 1 samples> <n / (phase 2 samples - 1)>\n"
+        << "min_size " << _min_size << "\n";
+    for (point const &p : _points) {
+        out << "point " << p.n << " " << std::setprecision(6) << p.phase_1_divisor << " " << p.phase_2_divisor << "\n";
+    }
+    out.close();
+    return bool(out);
+}
 
-tuned_ratio_sample_sizes::tuned_ratio_sample_sizes() {}
+///////////////////////////
+// adaptive_sample_sizes //
+///////////////////////////
 
-bool tuned_ratio_sample_sizes::is_size_acceptable(size_t n) {
-    return n >= 10;
+adaptive_sample_sizes::adaptive_sample_sizes(double target_miss_rate, size_t window):
+    _target_miss_rate(target_miss_rate), _window(window) {
+    for (bucket &b : _buckets) {
+        b = { 1, 0, 0, 0, 0, 0, 0 };
+    }
 }
 
-size_t tuned_ratio_sample_sizes::n_phase_1_samples(size_t n) {
-    return size_t(n / guess_y.value(n));
+bool adaptive_sample_sizes::is_size_acceptable(size_t n) {
+    return tuned_ratio_policy::is_size_acceptable(n);
 }
 
-size_t tuned_ratio_sample_sizes::n_phase_2_samples(size_t n, size_t phase_1) {
-    size_t guess = 1 + size_t (n / guess_x.value(n));
-    return std::min(guess, phase_1);
+size_t adaptive_sample_sizes::n_phase_1_samples(size_t n) {
+    double samples = tuned_ratio_policy::n_phase_1_samples(n) * std::sqrt(scale(n));
+    return std::clamp(size_t(samples), size_t(1), n / 2);
+}
+
+size_t adaptive_sample_sizes::n_phase_2_samples(size_t n, size_t phase_1) {
+    double samples = 1 + (tuned_ratio_policy::n_phase_2_samples(n, phase_1) - 1) * scale(n);
+    return std::clamp(size_t(samples), size_t(1), phase_1);
+}
+
+void adaptive_sample_sizes::feedback(size_t n, size_t, size_t, size_t band_size, bool hit) {
+    if (n < min_adaptive_size) {
+        return;
+    }
+    bucket &b = _buckets[bucket_of(n)];
+    ++b.calls;
+    b.misses += !hit;
+    b.band_sum += band_size;
+    b.size_sum += n;
+    ++b.window_calls;
+    b.window_misses += !hit;
+    if (b.window_calls < _window) {
+        return;
+    }
+    double target_misses = _target_miss_rate * double(_window);
+    double ratio = (double(b.window_misses) + 1) / (target_misses + 1);
+    b.scale = std::clamp(b.scale * std::pow(ratio, gain), min_scale, max_scale);
+    b.window_calls = 0;
+    b.window_misses = 0;
+}
+
+void adaptive_sample_sizes::display_and_reset_statistics(std::ostream &out) {
+    for (size_t i = 0; i < std::size(_buckets); ++i) {
+        bucket &b = _buckets[i];
+        if (b.calls == 0) {
+            continue;
+        }
+        out << "    [Sizes below 2^" << i
+            << ": calls: " << b.calls
+            << ", misses: " << b.misses
+            << ", band / size avg: " << double(b.band_sum) / double(b.size_sum)
+            << ", scale now: " << b.scale
+            << "]" << std::endl;
+        b.calls = 0;
+        b.misses = 0;
+        b.band_sum = 0;
+        b.size_sum = 0;
+    }
 }
@@ -13,19 +13,63 @@
  *     and that this part will be sufficiently smaller than the original array
  * - Count also the number of smaller/larger elements to validate where the sought statistic is
  * - If OK, continue with the smaller array (here, using std::nth_element)
- * - If not OK, failover to std::nth_element on the main array
+ * - If not OK, recover using what the filtering pass has learned (see recover())
+ *
+ * The filtering passes are done by the kernels from kth_statistic_filters.h,
+ * which are vectorized for the common element types.
+ *
+ * For many values of k at once (find_many), a single sample is taken,
+ * a band of the sample is selected around every k (the intersecting bands are merged),
+ * and a single pass copies the elements of all bands to the aux array,
+ * counting the elements above every band bound at the same time.
+ * These counts tell whether each k is in its band and at which position,
+ * so the bands are then processed with recursive partitioning on the aux array.
+ * The values of k which are not in their bands are found on the main array.
+ *
+ * To partition the array around k (partition_at), the filtering pass also moves the elements below the band
+ * to the front of the array, and the ones above it to the back of the aux array, which are then put in place
+ * together with the band, so that only the band has to be partitioned afterwards.
+ *
+ * With a non-zero recursion depth, the selections on the phase-1 sample and on the filtered band
+ * are done by a nested predicting_kth_statistic (with one less level of recursion)
+ * instead of std::nth_element, provided that they are large enough to benefit from it.
+ * Every level uses the same sample_sizes and has its own statistics.
+ *
+ * The sample sizes come either from a sample_sizes object, which is called virtually,
+ * or from a compile-time policy (such as tuned_ratio_policy) given as the second template argument,
+ * which is then inlined into find(); this matters for small arrays.
+ *
+ * The phase-1 sample is taken by a sampling strategy (see kth_statistic_sampling.h), the third template argument,
+ * which is the fixed stride by default. The sample is always read as if it came from equally spaced positions.
+ *
+ * The aux array comes from a workspace (see workspace.h), which may be shared with other engines.
  */
 
 #include <algorithm>
 #include <cassert>
+#include <bit>
+#include <concepts>
+#include <iostream>
 #include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include "kth_statistic.h"
+#include "kth_statistic_filters.h"
+#include "kth_statistic_hoare.h"
+#include "kth_statistic_network.h"
+#include "kth_statistic_sampling.h"
+#include "precalc_power.h"
+#include "workspace.h"
 
 struct sample_sizes {
     virtual bool is_size_acceptable(size_t n) = 0;
     virtual size_t n_phase_1_samples(size_t n) = 0;
     virtual size_t n_phase_2_samples(size_t n, size_t phase_1) = 0;
+    // Called by the predicting engines after every prediction with the sample sizes which were used,
+    // the number of elements which passed the filter, and whether the k-th element was among them
+    virtual void feedback(size_t n, size_t phase_1, size_t phase_2, size_t band_size, bool hit) {}
     virtual ~sample_sizes() {}
 };
 
@@ -46,16 +90,283 @@ struct tuned_ratio_sample_sizes : sample_sizes {
     size_t n_phase_2_samples(size_t n, size_t phase_1);
 };
 
-template<typename element_t>
+// The sample sizes from a profile fitted on the target machine by `tuning.exe --autotune`.
+// The profile is a piecewise power law: at every point n, it stores the divisors n / phase_1 and n / (phase_2 - 1),
+// which are interpolated linearly on the log-log scale between the points. Below the first point, they are constant,
+// and above the last one, they grow as those of tuned_ratio_sample_sizes do.
+// Until a profile is loaded, this is the same as tuned_ratio_sample_sizes.
+struct profiled_sample_sizes : sample_sizes {
+    struct point {
+        size_t n;
+        double phase_1_divisor, phase_2_divisor;
+    };
+
+    profiled_sample_sizes();
+    bool is_size_acceptable(size_t n);
+    size_t n_phase_1_samples(size_t n);
+    size_t n_phase_2_samples(size_t n, size_t phase_1);
+
+    // The points must be sorted by n, and all divisors must be at least 1.
+    void set(size_t min_size, std::vector<point> const &points);
+    // Returns false, leaving the current profile, if the file cannot be read or is malformed
+    bool load(char const *path);
+    bool save(char const *path) const;
+
+    bool is_profiled() const { return !_points.empty(); }
+    size_t min_size() const { return _min_size; }
+    std::vector<point> const &points() const { return _points; }
+
+private:
+    // the divisors for all n < n_tabulated are computed in advance, so that small arrays do not pay for the logarithms
+    static constexpr size_t n_tabulated = 1024;
+
+    size_t _min_size;
+    std::vector<point> _points;
+    std::vector<double> _phase_1_table, _phase_2_table;
+
+    void divisors(size_t n, double &phase_1_divisor, double &phase_2_divisor) const;
+    void interpolate(size_t n, double &phase_1_divisor, double &phase_2_divisor) const;
+};
+
+// The sample sizes which adapt to the input at runtime, using the feedback of the engines.
+// The sizes are those of tuned_ratio_sample_sizes, with phase 2 scaled by a factor, and phase 1 by its square root,
+// which keeps the selection on the phase-1 sample and the selection on the band in balance.
+// The factor is kept for every size bucket (the power of two of n), and adjusted after every window of calls
+// towards the target miss rate: the band is narrowed while there are fewer misses, and widened when there are more.
+// The misses are recovered from cheaply (see predicting_kth_statistic::recover()), so the best miss rate
+// is not zero but several percent, like that of tuned_ratio_sample_sizes on random data.
+// Small arrays, whose samples are only a few elements, always use the tuned sizes.
+// Not thread-safe: the engines which share it must be called from one thread at a time.
+struct adaptive_sample_sizes : sample_sizes {
+    adaptive_sample_sizes(double target_miss_rate = 1.0 / 16, size_t window = 64);
+    bool is_size_acceptable(size_t n);
+    size_t n_phase_1_samples(size_t n);
+    size_t n_phase_2_samples(size_t n, size_t phase_1);
+    void feedback(size_t n, size_t phase_1, size_t phase_2, size_t band_size, bool hit);
+
+    double scale(size_t n) const { return n < min_adaptive_size ? 1 : _buckets[bucket_of(n)].scale; }
+    void display_and_reset_statistics(std::ostream &out);
+
+private:
+    static constexpr size_t min_adaptive_size = 512;
+    static constexpr double min_scale = 1.0 / 16, max_scale = 16;
+    // how fast the factor follows the ratio of the actual and the target number of misses
+    static constexpr double gain = 0.25;
+
+    struct bucket {
+        double scale;
+        size_t window_calls, window_misses;
+        size_t calls, misses, band_sum, size_sum;
+    };
+
+    double _target_miss_rate;
+    size_t _window;
+    bucket _buckets[65];
+
+    static size_t bucket_of(size_t n) { return std::bit_width(n); }
+};
+
+// Anything which can tell the sample sizes: either a sample_sizes, or a compile-time policy like the ones below.
+template<typename sizes_t>
+concept sample_size_policy = requires(sizes_t &sizes, size_t n) {
+    { sizes.is_size_acceptable(n) } -> std::convertible_to<bool>;
+    { sizes.n_phase_1_samples(n) } -> std::convertible_to<size_t>;
+    { sizes.n_phase_2_samples(n, n) } -> std::convertible_to<size_t>;
+};
+
+// The same as fixed_ratio_sample_sizes, with the divisors known at compile time.
+template<size_t phase_1_divisor, size_t phase_2_divisor>
+struct fixed_ratio_policy {
+    static constexpr bool is_size_acceptable(size_t n) {
+        return n >= 2 * phase_1_divisor;
+    }
+
+    static constexpr size_t n_phase_1_samples(size_t n) {
+        return n / phase_1_divisor;
+    }
+
+    static constexpr size_t n_phase_2_samples(size_t, size_t phase_1) {
+        return std::min(phase_1, 1 + phase_1 / phase_2_divisor);
+    }
+};
+
+// The same as tuned_ratio_sample_sizes, which actually calls this.
+struct tuned_ratio_policy {
+    static constexpr bool is_size_acceptable(size_t n) {
+        return n >= 10;
+    }
+
+    static constexpr size_t n_phase_1_samples(size_t n) {
+        return size_t(n / guess_y.value(n));
+    }
+
+    static constexpr size_t n_phase_2_samples(size_t n, size_t phase_1) {
+        size_t guess = 1 + size_t(n / guess_x.value(n));
+        return std::min(guess, phase_1);
+    }
+};
+
+template<typename element_t, sample_size_policy sizes_t = sample_sizes,
+         sampling_strategy<element_t> sampler_t = strided_sampling>
 struct predicting_kth_statistic : kth_statistic<element_t> {
 private:
     size_t _size;
     char const *_name;
+    workspace *_workspace;
+    bool _owns_workspace;
+    // the memory of the workspace for the current call
     element_t *_mem;
     size_t _hits, _misses;
+    size_t _recovered_widened, _recovered_one_side, _full_fallbacks;
     size_t _phase_1_samples, _phase_2_samples;
     size_t _n_below, _n_mid, _n_above;
-    sample_sizes &_sample_sizes;
+    size_t _many_calls, _many_hits, _many_misses;
+    // virtual sample sizes are shared, policies are copied
+    std::conditional_t<std::is_polymorphic_v<sizes_t>, sizes_t &, sizes_t> _sample_sizes;
+    sampler_t _sampler;
+    size_t _level;
+    predicting_kth_statistic *_inner;
+
+    // Smaller arrays are never handed to the next level of recursion
+    static constexpr size_t min_recursive_size = 50000;
+
+    bool recurses_on(size_t n) const {
+        return _inner != nullptr && n >= min_recursive_size;
+    }
+
+    // Finds the k-th element of arr, either directly or using the next level of recursion
+    element_t select(element_t *arr, size_t n, size_t k) {
+        if (recurses_on(n)) {
+            return _inner->find(arr, n, k);
+        }
+        nth_element_or_network(arr, arr + k, arr + n);
+        return arr[k];
+    }
+
+    // Partitions arr around its k-th element, either directly or using the next level of recursion
+    void partition_select(element_t *arr, size_t n, size_t k) {
+        if (recurses_on(n)) {
+            _inner->partition_at(arr, n, k);
+        } else {
+            nth_element_or_network(arr, arr + k, arr + n);
+        }
+    }
+
+    // Compacts the elements below lower into the front of the array, and copies the elements between the bounds
+    // to the front of the aux array and the ones above upper to its back, where only the enabled bounds are checked.
+    // Then the latter two are copied back after the first ones, so that the array is split into three parts,
+    // of which the first two have n_less and n_band elements.
+    template<bool has_lower, bool has_upper>
+    void scatter(element_t *start, size_t size, element_t lower, element_t upper, size_t &n_less, size_t &n_band) {
+        element_t *less = start, *band = _mem, *greater = _mem + size - 1;
+        for (element_t *curr = start, *end = start + size; curr != end; ++curr) {
+            element_t value = *curr;
+            bool is_less = has_lower && value < lower;
+            bool is_greater = has_upper && upper < value;
+            *less = value;
+            less += is_less;
+            *band = value;
+            band += !(is_less | is_greater);
+            *greater = value;
+            greater -= is_greater;
+        }
+        n_less = less - start;
+        n_band = band - _mem;
+        std::copy(_mem, band, less);
+        std::copy(greater + 1, _mem + size, less + n_band);
+    }
+
+    // Tells the sample sizes how the prediction went, if they want to know
+    void feedback(size_t size, size_t n_samples, size_t n_samples_2, size_t band_size, bool hit) {
+        if constexpr (requires { _sample_sizes.feedback(size, n_samples, n_samples_2, band_size, hit); }) {
+            _sample_sizes.feedback(size, n_samples, n_samples_2, band_size, hit);
+        }
+    }
+
+    struct band {
+        size_t lower_idx, upper_idx;
+        bool unbounded_below, unbounded_above;
+        element_t lower, upper;
+    };
+
+    // The band of sample indices which find() would use for this k
+    static band sample_band(size_t k, size_t n_samples, size_t n_samples_2,
+                            size_t proportion, size_t offset_from_below, size_t size) {
+        if (k < offset_from_below) {
+            return { 0, n_samples_2 - 1, true, false, element_t(), element_t() };
+        } else if (size - k < offset_from_below) {
+            return { n_samples - n_samples_2, n_samples - 1, false, true, element_t(), element_t() };
+        } else {
+            size_t expected_idx = (k - offset_from_below) / proportion;
+            size_t lower_idx = expected_idx < n_samples_2 / 2 ? 0 : expected_idx - n_samples_2 / 2;
+            size_t higher_idx = lower_idx + n_samples_2 - 1;
+            if (higher_idx >= n_samples) {
+                higher_idx = n_samples - 1;
+                lower_idx = higher_idx - n_samples_2 + 1;
+            }
+            return { lower_idx, higher_idx, false, false, element_t(), element_t() };
+        }
+    }
+
+    /*
+     * Finds the k-th element after a failed prediction, knowing that it is less than bound (if below is true)
+     * or greater than bound (otherwise), and that there are side_size such elements (zero if unknown).
+     *
+     * First, a second prediction round is done: the sample is taken again, and a band is chosen
+     * from the part of the sample on the right side of the bound, proportionally to where k is
+     * within that side, and is extended up to the bound itself.
+     * If this also fails, all the elements on the right side of the bound are filtered,
+     * which is sure to contain the k-th element.
+     * Only if this is impossible for some reason, introselect (which is linear in the worst case) runs on the main array.
+     */
+    element_t recover(element_t *start, size_t size, size_t k,
+                      bool below, element_t bound, size_t side_size,
+                      size_t n_samples, size_t n_samples_2) {
+        filter_kernel_set<element_t> const &filters = filter_kernels<element_t>();
+        // the rank of k among the elements on its side of the bound
+        size_t side_k = below ? k : k - (size - side_size);
+
+        if (side_size > 0) {
+            _sampler.sample(start, size, _mem, n_samples);
+            element_t *side_end = below
+                ? std::partition(_mem, _mem + n_samples, [bound](element_t const &x) { return x < bound; })
+                : std::partition(_mem, _mem + n_samples, [bound](element_t const &x) { return bound < x; });
+            size_t side_samples = side_end - _mem;
+            size_t expected_idx = side_k * side_samples / side_size;
+            element_t *mem_end = _mem;
+            size_t n_less = 0;
+            bool widened = false;
+            if (below && expected_idx >= n_samples_2) {
+                element_t lower = select(_mem, side_samples, expected_idx - n_samples_2);
+                mem_end = filters.between(start, start + size, lower, bound, _mem, n_less);
+                widened = true;
+            } else if (!below && expected_idx + n_samples_2 < side_samples) {
+                element_t upper = select(_mem, side_samples, expected_idx + n_samples_2);
+                mem_end = filters.between(start, start + size, bound, upper, _mem, n_less);
+                widened = true;
+            }
+            if (widened && k >= n_less && k - n_less < size_t(mem_end - _mem)) {
+                ++_recovered_widened;
+                return select(_mem, mem_end - _mem, k - n_less);
+            }
+        }
+
+        // everything on the right side of the bound, together with the elements equal to it
+        element_t *mem_end = below
+            ? filters.not_greater(start, start + size, bound, _mem)
+            : filters.not_less(start, start + size, bound, _mem);
+        size_t n_filtered = mem_end - _mem;
+        size_t filtered_k = below ? k : k - (size - n_filtered);
+        if (k < size && (below ? k < n_filtered : k >= size - n_filtered)) {
+            ++_recovered_one_side;
+            return select(_mem, n_filtered, filtered_k);
+        }
+
+        ++_full_fallbacks;
+        introspective_select<element_t>::select(start, start + size - 1, start + k,
+                                                introspective_select<element_t>::default_budget_factor);
+        return start[k];
+    }
 
 public:
     char const *name() const { return _name; }
@@ -63,47 +374,110 @@ public:
     bool is_destructive() const { return false; } // actually false as we use the aux array
     size_t size() { return _size; }
 
-    predicting_kth_statistic(sample_sizes &sample_sizes,
+    // Without a shared workspace, a private one is used; the nested levels always have private workspaces,
+    // and copies of the sampler
+    predicting_kth_statistic(sizes_t &sample_sizes,
                              const char *name,
-                             size_t initial_size = 1)
+                             size_t initial_size = 1,
+                             size_t recursion_depth = 0,
+                             workspace *shared_workspace = nullptr,
+                             sampler_t const &sampler = sampler_t())
     : _size(initial_size), _name(name),
-      _hits(0), _misses(0), _phase_1_samples(0), _phase_2_samples(0),
+      _workspace(shared_workspace != nullptr ? shared_workspace : new workspace()),
+      _owns_workspace(shared_workspace == nullptr),
+      _hits(0), _misses(0),
+      _recovered_widened(0), _recovered_one_side(0), _full_fallbacks(0),
+      _phase_1_samples(0), _phase_2_samples(0),
       _n_below(0), _n_mid(0), _n_above(0),
-      _sample_sizes(sample_sizes) {
-        _mem = new element_t[_size];
+      _many_calls(0), _many_hits(0), _many_misses(0),
+      _sample_sizes(sample_sizes), _sampler(sampler), _level(0), _inner(nullptr) {
+        _mem = _workspace->get<element_t>(_size);
+        if (recursion_depth > 0) {
+            _inner = new predicting_kth_statistic(sample_sizes, name, initial_size, recursion_depth - 1, nullptr, sampler);
+            _inner->_level = _level + 1;
+        }
     }
 
     void resize(size_t new_size) {
-        if (_size != new_size) {
-            delete[] _mem;
-            _size = new_size;
-            _mem = new element_t[_size];
+        _size = new_size;
+        _mem = _workspace->get<element_t>(_size);
+        if (_inner != nullptr) {
+            _inner->resize(new_size);
         }
     }
 
     ~predicting_kth_statistic() {
-        delete[] _mem;
+        if (_owns_workspace) {
+            delete _workspace;
+        }
+        delete _inner;
     }
 
     void display_and_reset_statistics(std::ostream &out) {
-        out << "    [Hits: " << _hits
+        out << "    [";
+        if (_inner != nullptr || _level > 0) {
+            out << "Level " << _level << ": ";
+        }
+        out << "Hits: " << _hits
             << ", misses: " << _misses
-            << ", phase 1 samples avg: " << double(_phase_1_samples) / (_hits + _misses)
+            << " (recovered with widened band: " << _recovered_widened
+            << ", with one side: " << _recovered_one_side
+            << ", full fallback: " << _full_fallbacks
+            << "), phase 1 samples avg: " << double(_phase_1_samples) / (_hits + _misses)
             << ", phase 2 samples avg: " << double(_phase_2_samples) / _hits
             << ", below: " << _n_below << ", mid: " << _n_mid << ", above: " << _n_above
             << "]" << std::endl;
+        if (_many_calls > 0) {
+            out << "    [Multi-k calls: " << _many_calls
+                << ", hits: " << _many_hits
+                << ", misses: " << _many_misses
+                << "]" << std::endl;
+        }
         _hits = 0;
         _misses = 0;
+        _recovered_widened = 0;
+        _recovered_one_side = 0;
+        _full_fallbacks = 0;
         _phase_1_samples = 0;
         _phase_2_samples = 0;
         _n_below = 0;
         _n_mid = 0;
         _n_above = 0;
+        _many_calls = 0;
+        _many_hits = 0;
+        _many_misses = 0;
+        if (_inner != nullptr) {
+            _inner->display_and_reset_statistics(out);
+        }
+    }
+
+    // Adds the statistics of this engine and its nested levels to those of total, which must be as deep,
+    // and resets them, so that the statistics of many engines can be displayed as one
+    void add_statistics_to(predicting_kth_statistic &total) {
+        total._hits += std::exchange(_hits, 0);
+        total._misses += std::exchange(_misses, 0);
+        total._recovered_widened += std::exchange(_recovered_widened, 0);
+        total._recovered_one_side += std::exchange(_recovered_one_side, 0);
+        total._full_fallbacks += std::exchange(_full_fallbacks, 0);
+        total._phase_1_samples += std::exchange(_phase_1_samples, 0);
+        total._phase_2_samples += std::exchange(_phase_2_samples, 0);
+        total._n_below += std::exchange(_n_below, 0);
+        total._n_mid += std::exchange(_n_mid, 0);
+        total._n_above += std::exchange(_n_above, 0);
+        total._many_calls += std::exchange(_many_calls, 0);
+        total._many_hits += std::exchange(_many_hits, 0);
+        total._many_misses += std::exchange(_many_misses, 0);
+        if (_inner != nullptr && total._inner != nullptr) {
+            _inner->add_statistics_to(*total._inner);
+        }
     }
 
-    element_t find(element_t *start, size_t size, size_t k) {
-        if (!_sample_sizes.is_size_acceptable(size)) {
-            std::nth_element(start, start + k, start + size);
+    // final, so that the calls from within this class and from its nested levels are not virtual
+    element_t find(element_t *start, size_t size, size_t k) final {
+        _mem = _workspace->get<element_t>(size);
+        // a network sorts the tiny arrays faster than any prediction could help
+        if (!_sample_sizes.is_size_acceptable(size) || (uses_networks<element_t> && size <= max_network_size)) {
+            nth_element_or_network(start, start + k, start + size);
             return start[k];
         }
 
@@ -111,39 +485,42 @@ public:
         const size_t proportion = size / n_samples;
         const size_t offset_from_below = (size - (n_samples - 1) * proportion + 1) / 2;
 
-        for (size_t i = 0, j = offset_from_below; i < n_samples; ++i, j += proportion) {
-            assert(j < size);
-            _mem[i] = start[j];
-        }
+        _sampler.sample(start, size, _mem, n_samples);
         _phase_1_samples += n_samples;
 
         const size_t n_samples_2 = _sample_sizes.n_phase_2_samples(size, n_samples);
         assert(n_samples_2 <= n_samples);
 
+        filter_kernel_set<element_t> const &filters = filter_kernels<element_t>();
+
         element_t *last = start + size - 1;
         element_t *mem_end = _mem;
         element_t *subsampled_k;
 
+        // where the k-th element is if the prediction fails: below or above the bound,
+        // and how many elements are there on that side (zero if not known)
+        bool miss_below;
+        element_t miss_bound;
+        size_t miss_side_size;
+
         if (k < offset_from_below) {
             ++_n_below;
             // k-th order stat is likely <= the smallest element
-            std::nth_element(_mem, _mem + n_samples_2 - 1, _mem + n_samples);
-            element_t upper = _mem[n_samples_2 - 1];
-            for (element_t *curr = start; curr <= last; ++curr) {
-                *mem_end = *curr;
-                mem_end += *curr <= upper;
-            }
+            element_t upper = select(_mem, n_samples, n_samples_2 - 1);
+            mem_end = filters.not_greater(start, last + 1, upper, _mem);
             subsampled_k = _mem + k;
+            miss_below = false;
+            miss_bound = upper;
+            miss_side_size = size - (mem_end - _mem);
         } else if (size - k < offset_from_below) {
             ++_n_above;
             // k-th order stat is likely >= the greatest element
-            std::nth_element(_mem, _mem + n_samples - n_samples_2, _mem + n_samples);
-            element_t lower = _mem[n_samples - n_samples_2];
-            for (element_t *curr = start; curr <= last; ++curr) {
-                *mem_end = *curr;
-                mem_end += *curr >= lower;
-            }
+            element_t lower = select(_mem, n_samples, n_samples - n_samples_2);
+            mem_end = filters.not_less(start, last + 1, lower, _mem);
             subsampled_k = mem_end - (size - k);
+            miss_below = true;
+            miss_bound = lower;
+            miss_side_size = size - (mem_end - _mem);
         } else {
             ++_n_mid;
             element_t *expected_idx = _mem + (k - offset_from_below) / proportion;
@@ -159,11 +536,19 @@ public:
                 lower_idx = higher_idx - n_samples_2 + 1;
             }
             assert(lower_idx >= _mem);
-            std::nth_element(_mem, lower_idx, _mem + n_samples);
-            std::nth_element(lower_idx + 1, higher_idx, _mem + n_samples);
-
-            element_t lower = *lower_idx;
-            element_t upper = *higher_idx;
+            element_t lower, upper;
+            if (recurses_on(n_samples)) {
+                size_t bounds_idx[2] = { size_t(lower_idx - _mem), size_t(higher_idx - _mem) };
+                element_t bounds[2];
+                _inner->find_many(_mem, n_samples, bounds_idx, 2, bounds);
+                lower = bounds[0];
+                upper = bounds[1];
+            } else {
+                nth_element_or_network(_mem, lower_idx, _mem + n_samples);
+                nth_element_or_network(lower_idx + 1, higher_idx, _mem + n_samples);
+                lower = *lower_idx;
+                upper = *higher_idx;
+            }
 
             element_t *m_start = start;
 
@@ -186,42 +571,209 @@ public:
             }
 
             subsampled_k = _mem - 1; // only used if failed
+            miss_below = true;
+            miss_bound = lower;
+            miss_side_size = 0;
 
             if (k >= k_change) {
                 size_t k_mod = k - k_change;
+                size_t count_less = 0;
+                size_t count_mid = 0;
                 if (lower == upper) {
-                    size_t count_less = 0;
-                    size_t count_eq = 0;
-                    for (element_t *curr = m_start; curr <= last; ++curr) {
-                        count_less += *curr < lower;
-                        count_eq += *curr == lower;
-                    }
-                    if (k_mod >= count_less && k_mod < count_less + count_eq) {
+                    filters.count_less_equal(m_start, last + 1, lower, count_less, count_mid);
+                    if (k_mod >= count_less && k_mod < count_less + count_mid) {
                         ++_hits;
+                        feedback(size, n_samples, n_samples_2, count_mid, true);
                         return lower;
                     }
                 } else {
-                    subsampled_k = _mem + k_mod;
-                    for (element_t *curr = m_start; curr <= last; ++curr) {
-                        *mem_end = *curr;
-                        bool is_lower = *curr < lower;
-                        bool is_good = !is_lower && *curr <= upper;
-                        subsampled_k -= is_lower;
-                        mem_end += is_good;
-                    }
+                    mem_end = filters.between(m_start, last + 1, lower, upper, _mem, count_less);
+                    subsampled_k = _mem + k_mod - count_less;
+                    count_mid = mem_end - _mem;
                 }
+                size_t n_lower = k_change + count_less;
+                miss_below = k < n_lower;
+                miss_bound = miss_below ? lower : upper;
+                miss_side_size = miss_below ? n_lower : size - n_lower - count_mid;
             }
         }
 
         if (subsampled_k >= _mem && subsampled_k < mem_end) {
             ++_hits;
             _phase_2_samples += mem_end - _mem;
-            std::nth_element(_mem, subsampled_k, mem_end);
-            return *subsampled_k;
+            feedback(size, n_samples, n_samples_2, mem_end - _mem, true);
+            return select(_mem, mem_end - _mem, subsampled_k - _mem);
         } else {
             ++_misses;
-            std::nth_element(start, start + k, start + size);
-            return start[k];
+            feedback(size, n_samples, n_samples_2, mem_end - _mem, false);
+            return recover(start, size, k, miss_below, miss_bound, miss_side_size, n_samples, n_samples_2);
+        }
+    }
+
+    /*
+     * The same prediction as in find(), but the filtering pass also scatters the elements below the band,
+     * in the band and above it (see scatter()), so that only the part which contains k is left to partition.
+     * If the prediction fails, this part is one of the sides, rather than the whole array.
+     */
+    void partition_at(element_t *start, size_t size, size_t k) {
+        _mem = _workspace->get<element_t>(size);
+        // a network sorts the tiny arrays faster than any prediction could help
+        if (!_sample_sizes.is_size_acceptable(size) || (uses_networks<element_t> && size <= max_network_size)) {
+            nth_element_or_network(start, start + k, start + size);
+            return;
+        }
+
+        const size_t n_samples = _sample_sizes.n_phase_1_samples(size);
+        const size_t proportion = size / n_samples;
+        const size_t offset_from_below = (size - (n_samples - 1) * proportion + 1) / 2;
+
+        _sampler.sample(start, size, _mem, n_samples);
+        _phase_1_samples += n_samples;
+
+        const size_t n_samples_2 = _sample_sizes.n_phase_2_samples(size, n_samples);
+        assert(n_samples_2 <= n_samples);
+
+        band b = sample_band(k, n_samples, n_samples_2, proportion, offset_from_below, size);
+        if (!b.unbounded_below) {
+            // the upper bound is then selected among the greater samples
+            partition_select(_mem, n_samples, b.lower_idx);
+            b.lower = _mem[b.lower_idx];
+        }
+        if (!b.unbounded_above) {
+            b.upper = b.unbounded_below ? select(_mem, n_samples, b.upper_idx)
+                    : b.upper_idx == b.lower_idx ? b.lower
+                    : select(_mem + b.lower_idx + 1, n_samples - b.lower_idx - 1, b.upper_idx - b.lower_idx - 1);
+        }
+
+        size_t n_less, n_band;
+        if (b.unbounded_below) {
+            ++_n_below;
+            scatter<false, true>(start, size, b.lower, b.upper, n_less, n_band);
+        } else if (b.unbounded_above) {
+            ++_n_above;
+            scatter<true, false>(start, size, b.lower, b.upper, n_less, n_band);
+        } else {
+            ++_n_mid;
+            scatter<true, true>(start, size, b.lower, b.upper, n_less, n_band);
+        }
+
+        bool hit = k >= n_less && k - n_less < n_band;
+        feedback(size, n_samples, n_samples_2, n_band, hit);
+        if (hit) {
+            ++_hits;
+            _phase_2_samples += n_band;
+            partition_select(start + n_less, n_band, k - n_less);
+        } else if (k < n_less) {
+            ++_misses;
+            partition_select(start, n_less, k);
+        } else {
+            ++_misses;
+            partition_select(start + n_less + n_band, size - n_less - n_band, k - n_less - n_band);
+        }
+    }
+
+    void find_many(element_t *start, size_t size, size_t const *ks, size_t n_ks, element_t *out) {
+        if (n_ks == 1) {
+            out[0] = find(start, size, ks[0]);
+            return;
+        }
+        _mem = _workspace->get<element_t>(size);
+        if (n_ks == 0 || !_sample_sizes.is_size_acceptable(size)) {
+            kth_statistic<element_t>::find_many(start, size, ks, n_ks, out);
+            return;
+        }
+        ++_many_calls;
+
+        std::vector<size_t> sorted_ks = sorted_unique_ks(ks, n_ks);
+
+        const size_t n_samples = _sample_sizes.n_phase_1_samples(size);
+        const size_t proportion = size / n_samples;
+        const size_t offset_from_below = (size - (n_samples - 1) * proportion + 1) / 2;
+
+        _sampler.sample(start, size, _mem, n_samples);
+
+        const size_t n_samples_2 = _sample_sizes.n_phase_2_samples(size, n_samples);
+        assert(n_samples_2 <= n_samples);
+
+        // bands of sample indices, merged if they intersect
+        std::vector<band> bands;
+        for (size_t k : sorted_ks) {
+            band b = sample_band(k, n_samples, n_samples_2, proportion, offset_from_below, size);
+            if (!bands.empty() && b.lower_idx <= bands.back().upper_idx) {
+                bands.back().upper_idx = std::max(bands.back().upper_idx, b.upper_idx);
+                bands.back().unbounded_above |= b.unbounded_above;
+            } else {
+                bands.push_back(b);
+            }
+        }
+
+        std::vector<size_t> sample_ks;
+        for (band const &b : bands) {
+            if (!b.unbounded_below) sample_ks.push_back(b.lower_idx);
+            if (!b.unbounded_above) sample_ks.push_back(b.upper_idx);
+        }
+        sample_ks.erase(std::unique(sample_ks.begin(), sample_ks.end()), sample_ks.end());
+        multi_nth_element(_mem, n_samples, sample_ks.data(), sample_ks.data() + sample_ks.size());
+
+        // bands of values, merged if they intersect, so that every element is in at most one band
+        size_t n_bands = 0;
+        for (band &b : bands) {
+            b.lower = _mem[b.lower_idx];
+            b.upper = _mem[b.upper_idx];
+            if (n_bands > 0 && (b.unbounded_below || b.lower <= bands[n_bands - 1].upper)) {
+                bands[n_bands - 1].upper = b.upper;
+                bands[n_bands - 1].unbounded_above |= b.unbounded_above;
+            } else {
+                bands[n_bands++] = b;
+            }
+        }
+        bands.resize(n_bands);
+
+        // a single pass copies the elements of all bands, and counts the elements above every bound
+        std::vector<element_t> bounds;
+        for (band const &b : bands) {
+            if (!b.unbounded_below) bounds.push_back(b.lower);
+            if (!b.unbounded_above) bounds.push_back(b.upper);
+        }
+        std::vector<size_t> n_passed(bounds.size(), 0);
+        element_t *mem_end = filter_kernels<element_t>().bands(start, start + size,
+                                                               bounds.data(), bounds.size(),
+                                                               bands.front().unbounded_below,
+                                                               _mem, n_passed.data());
+
+        // find the bands of all k, and where the k-th element goes in the filtered array
+        std::vector<size_t> hit_ks, filtered_ks, missed_ks;
+        size_t band_idx = 0, bound_idx = 0, band_filtered_rank = 0;
+        size_t band_begin = 0, band_end = 0;
+        for (size_t k : sorted_ks) {
+            while (band_idx < n_bands && band_end <= k) {
+                band_filtered_rank += band_end - band_begin;
+                band_begin = bands[band_idx].unbounded_below ? 0 : size - n_passed[bound_idx++];
+                band_end = bands[band_idx].unbounded_above ? size : size - n_passed[bound_idx++];
+                ++band_idx;
+            }
+            if (band_begin <= k && k < band_end) {
+                hit_ks.push_back(k);
+                filtered_ks.push_back(k - band_begin + band_filtered_rank);
+            } else {
+                missed_ks.push_back(k);
+            }
+        }
+        _many_hits += hit_ks.size();
+        _many_misses += missed_ks.size();
+
+        std::vector<element_t> sorted_values(sorted_ks.size());
+        multi_nth_element(_mem, mem_end - _mem, filtered_ks.data(), filtered_ks.data() + filtered_ks.size());
+        for (size_t i = 0; i < hit_ks.size(); ++i) {
+            sorted_values[std::lower_bound(sorted_ks.begin(), sorted_ks.end(), hit_ks[i]) - sorted_ks.begin()]
+                = _mem[filtered_ks[i]];
+        }
+        multi_nth_element(start, size, missed_ks.data(), missed_ks.data() + missed_ks.size());
+        for (size_t k : missed_ks) {
+            sorted_values[std::lower_bound(sorted_ks.begin(), sorted_ks.end(), k) - sorted_ks.begin()] = start[k];
+        }
+        for (size_t i = 0; i < n_ks; ++i) {
+            out[i] = sorted_values[std::lower_bound(sorted_ks.begin(), sorted_ks.end(), ks[i]) - sorted_ks.begin()];
         }
     }
 };
@@ -0,0 +1,155 @@
+#pragma once
+
+/*
+ * Radix selection (MSD radix sort which only follows the bucket containing k).
+ *
+ * Every element is mapped to an unsigned key with the same ordering (see radix_key).
+ * Then, starting from the most significant digit:
+ * - the histogram of the current digit is built;
+ * - the bucket which contains the k-th element is found, and k is made relative to this bucket;
+ * - the elements of this bucket are copied to the aux array (this is skipped if there is only one bucket),
+ *   which becomes the array for the next digit.
+ * Once the array is small enough, std::nth_element finishes the job.
+ * If all the digits are processed, all the remaining elements are equal.
+ *
+ * Only the types with radix_key specializations are supported:
+ * integral types, float and double (NaNs are not supported).
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#include "kth_statistic.h"
+#include "kth_statistic_network.h"
+#include "workspace.h"
+
+template<typename element_t, typename enable = void>
+struct radix_key;
+
+template<typename element_t>
+struct radix_key<element_t, typename std::enable_if<std::is_integral<element_t>::value>::type> {
+    typedef typename std::make_unsigned<element_t>::type key_t;
+
+    static key_t of(element_t value) {
+        key_t key = key_t(value);
+        if (std::is_signed<element_t>::value) {
+            key ^= key_t(1) << (std::numeric_limits<key_t>::digits - 1);
+        }
+        return key;
+    }
+};
+
+// The usual order-preserving map for IEEE 754 values:
+// negative values get all bits inverted, non-negative ones get the sign bit set.
+template<typename element_t, typename bits_t>
+struct radix_key_floating {
+    static_assert(sizeof(element_t) == sizeof(bits_t));
+    typedef bits_t key_t;
+
+    static key_t of(element_t value) {
+        key_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        constexpr unsigned sign_shift = std::numeric_limits<key_t>::digits - 1;
+        // all ones for negative values, only the sign bit for the others, without branching
+        key_t flip = key_t(-key_t(bits >> sign_shift)) | (key_t(1) << sign_shift);
+        return bits ^ flip;
+    }
+};
+
+template<> struct radix_key<float> : radix_key_floating<float, uint32_t> {};
+template<> struct radix_key<double> : radix_key_floating<double, uint64_t> {};
+
+template<typename element_t, unsigned digit_bits = 8>
+struct radix_kth_statistic : kth_statistic<element_t> {
+private:
+    typedef typename radix_key<element_t>::key_t key_t;
+    static constexpr unsigned key_bits = std::numeric_limits<key_t>::digits;
+    static constexpr size_t n_buckets = size_t(1) << digit_bits;
+    static constexpr size_t small_size = 256;
+
+    size_t _size;
+    char const *_name;
+    workspace *_workspace;
+    bool _owns_workspace;
+    // the memory of the workspace for the current call
+    element_t *_mem;
+    size_t _calls, _levels, _copies;
+    size_t _histogram[n_buckets];
+
+public:
+    char const *name() const { return _name; }
+    bool is_inplace() const { return false; }
+    bool is_destructive() const { return false; }
+    size_t size() { return _size; }
+
+    radix_kth_statistic(const char *name, size_t initial_size = 1, workspace *shared_workspace = nullptr)
+    : _size(initial_size), _name(name),
+      _workspace(shared_workspace != nullptr ? shared_workspace : new workspace()),
+      _owns_workspace(shared_workspace == nullptr),
+      _calls(0), _levels(0), _copies(0) {
+        _mem = _workspace->get<element_t>(_size);
+    }
+
+    void resize(size_t new_size) {
+        _size = new_size;
+        _mem = _workspace->get<element_t>(_size);
+    }
+
+    ~radix_kth_statistic() {
+        if (_owns_workspace) {
+            delete _workspace;
+        }
+    }
+
+    void display_and_reset_statistics(std::ostream &out) {
+        out << "    [Calls: " << _calls
+            << ", digits per call avg: " << double(_levels) / _calls
+            << ", copies per call avg: " << double(_copies) / _calls
+            << "]" << std::endl;
+        _calls = 0;
+        _levels = 0;
+        _copies = 0;
+    }
+
+    element_t find(element_t *start, size_t size, size_t k) {
+        ++_calls;
+        _mem = _workspace->get<element_t>(size);
+        element_t *src = start;
+        unsigned shift = key_bits > digit_bits ? key_bits - digit_bits : 0;
+        while (size > small_size) {
+            ++_levels;
+            std::fill(_histogram, _histogram + n_buckets, 0);
+            for (element_t *curr = src, *end = src + size; curr != end; ++curr) {
+                ++_histogram[(radix_key<element_t>::of(*curr) >> shift) & (n_buckets - 1)];
+            }
+
+            size_t bucket = 0;
+            while (k >= _histogram[bucket]) {
+                k -= _histogram[bucket];
+                ++bucket;
+            }
+
+            if (_histogram[bucket] != size) {
+                ++_copies;
+                element_t *dst = _mem;
+                for (element_t *curr = src, *end = src + size; curr != end; ++curr) {
+                    *dst = *curr;
+                    dst += ((radix_key<element_t>::of(*curr) >> shift) & (n_buckets - 1)) == bucket;
+                }
+                src = _mem;
+                size = dst - _mem;
+            }
+
+            if (shift == 0) {
+                // all remaining elements have the same key
+                return src[k];
+            }
+            shift = shift > digit_bits ? shift - digit_bits : 0;
+        }
+        nth_element_or_network(src, src + k, src + size);
+        return src[k];
+    }
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+/*
+ * The strategies of taking the phase-1 sample of the predicting engines.
+ *
+ * A strategy copies n_samples elements of the array to the sample. The engines read the sample as n_samples ranks
+ * equally spaced over the array, whichever elements were taken, so any strategy whose sample is spread
+ * evenly over the array in expectation will do:
+ * - strided_sampling takes every proportion-th element, centered in the array, as the engines always did.
+ *   This is the cheapest to compute and the sample is exactly even, but every element is a separate cache miss
+ *   for large arrays, and inputs with a period which divides the stride fool it every time.
+ * - random_sampling takes the elements at random positions, from a fast generator. No input fools it
+ *   more often than chance, but the accesses are as scattered as those of the stride, and not even predictable.
+ * - block_sampling splits the array into as many strata as there are blocks, and takes a randomly placed block
+ *   of consecutive cache lines in every stratum, one element per cache line. The lines of a block are adjacent,
+ *   so the hardware prefetcher streams them, while the random placement still does not fall into periods.
+ *   On the other hand, the elements of a block are close to each other, so if the input is locally ordered,
+ *   they are correlated, and the sample is worth fewer independent elements than it has.
+ *
+ * A strategy is a copyable object with a template member sample(start, size, out, n_samples), which may keep state,
+ * like the generator here. It is the third template argument of predicting_kth_statistic, so that it is inlined.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+
+template<typename sampler_t, typename element_t>
+concept sampling_strategy = std::copy_constructible<sampler_t>
+    && requires(sampler_t &sampler, element_t const *start, size_t size, element_t *out) {
+    sampler.sample(start, size, out, size);
+};
+
+struct strided_sampling {
+    template<typename element_t>
+    void sample(element_t const *start, size_t size, element_t *out, size_t n_samples) {
+        const size_t proportion = size / n_samples;
+        const size_t offset_from_below = (size - (n_samples - 1) * proportion + 1) / 2;
+        for (size_t i = 0, j = offset_from_below; i < n_samples; ++i, j += proportion) {
+            assert(j < size);
+            out[i] = start[j];
+        }
+    }
+};
+
+// The generator of the random strategies: xorshift64*, which is plenty for choosing the positions
+struct sampling_rng {
+    uint64_t state;
+
+    explicit sampling_rng(uint64_t seed) : state(seed != 0 ? seed : 0x9E3779B97F4A7C15ULL) {}
+
+    uint64_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1DULL;
+    }
+
+    // A number below bound, without a division (bound must be below 2^32, else it is taken modulo)
+    size_t below(size_t bound) {
+        uint64_t r = next();
+        return bound <= (uint64_t(1) << 32) ? size_t(((r >> 32) * bound) >> 32) : size_t(r % bound);
+    }
+};
+
+struct random_sampling {
+    sampling_rng rng;
+
+    explicit random_sampling(uint64_t seed = 12314342342342ULL) : rng(seed) {}
+
+    template<typename element_t>
+    void sample(element_t const *start, size_t size, element_t *out, size_t n_samples) {
+        for (size_t i = 0; i < n_samples; ++i) {
+            out[i] = start[rng.below(size)];
+        }
+    }
+};
+
+struct block_sampling {
+    static constexpr size_t cache_line = 64;
+
+    sampling_rng rng;
+    size_t n_blocks;
+
+    explicit block_sampling(size_t n_blocks = 32, uint64_t seed = 12314342342342ULL)
+    : rng(seed), n_blocks(std::max<size_t>(1, n_blocks)) {}
+
+    template<typename element_t>
+    void sample(element_t const *start, size_t size, element_t *out, size_t n_samples) {
+        const size_t line = std::max<size_t>(1, cache_line / sizeof(element_t));
+        const size_t blocks = std::min(n_blocks, n_samples);
+        for (size_t b = 0, i = 0; b < blocks; ++b) {
+            // the share of the samples of this block, and the stratum in proportion to it, which is no shorter
+            size_t i_end = n_samples * (b + 1) / blocks, n = i_end - i;
+            size_t from = size * i / n_samples, to = size * i_end / n_samples;
+            // one element per cache line, unless the stratum is too short for that
+            size_t step = std::min(line, (to - from) / n);
+            size_t span = (n - 1) * step + 1;
+            size_t j = from + rng.below(to - from - span + 1);
+            for (; i < i_end; ++i, j += step) {
+                assert(j < to);
+                out[i] = start[j];
+            }
+        }
+    }
+};
@@ -0,0 +1,147 @@
+#pragma once
+
+/*
+ * Order statistics of a sliding window of a stream.
+ *
+ * Elements are pushed to the back of the window and popped from its front,
+ * and the k-th order statistic of the elements currently in the window can be queried at any time.
+ *
+ * The window is split by value into buckets: bucket i contains the elements x such that
+ * bounds[i - 1] <= x < bounds[i]. Every bucket is kept sorted, so the concatenation
+ * of all buckets is the sorted window.
+ * - push finds the bucket with a binary search over the bounds, and inserts the element into it;
+ * - pop does the same for the oldest element, which it knows from a FIFO copy of the window
+ *   (as equal elements are always in the same bucket, any one of them may be removed, and the last one is,
+ *   so that a bucket of a single value shrinks from its end);
+ * - query walks the bucket sizes to find the bucket of k, and then takes the element directly.
+ *
+ * With buckets of about sqrt(w) elements, where w is the window size, all this takes O(sqrt(w)).
+ * The bounds are quantiles of the window, taken at the last rebuild. If the distribution of the stream drifts,
+ * some bucket eventually becomes too large, and then all buckets are rebuilt by cutting the sorted window
+ * into equal parts, which takes O(w). A run of equal elements cannot be cut, so a bucket may be left larger
+ * than sqrt(w) by the rebuild, and a bucket is too large only at four times the larger of sqrt(w)
+ * and the largest bucket left by the rebuild; either way, it has taken O(sqrt(w)) pushes since the rebuild.
+ * The same happens if the window becomes much smaller than it was at the last rebuild.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <deque>
+#include <iostream>
+#include <vector>
+
+template<typename element_t>
+struct sliding_kth_statistic {
+private:
+    static constexpr size_t min_bucket_size = 32;
+
+    char const *_name;
+    std::deque<element_t> _window;
+    std::vector<element_t> _bounds;
+    std::vector< std::vector<element_t> > _buckets;
+    std::vector<element_t> _sorted;
+    size_t _max_bucket_size, _min_window_size;
+    size_t _pushes, _rebuilds;
+
+    size_t bucket_of(element_t const &value) const {
+        return std::upper_bound(_bounds.begin(), _bounds.end(), value) - _bounds.begin();
+    }
+
+    void rebuild() {
+        ++_rebuilds;
+        size_t n = _window.size();
+        _sorted.clear();
+        for (std::vector<element_t> const &bucket : _buckets) {
+            _sorted.insert(_sorted.end(), bucket.begin(), bucket.end());
+        }
+        assert(_sorted.size() == n);
+
+        size_t target = std::max(min_bucket_size, size_t(std::sqrt(double(n))));
+        size_t largest = 0;
+        _bounds.clear();
+        _buckets.clear();
+        for (size_t from = 0; from < n; ) {
+            size_t until = std::min(n, from + target);
+            if (until < n) {
+                // the elements equal to the first element of the next bucket must all go there
+                element_t const &next = _sorted[until];
+                size_t cut = std::lower_bound(_sorted.begin() + from, _sorted.begin() + until, next) - _sorted.begin();
+                until = cut > from ? cut : std::upper_bound(_sorted.begin() + until, _sorted.end(), next) - _sorted.begin();
+            }
+            _buckets.emplace_back(_sorted.begin() + from, _sorted.begin() + until);
+            largest = std::max(largest, until - from);
+            if (until < n) {
+                _bounds.push_back(_sorted[until]);
+            }
+            from = until;
+        }
+        if (_buckets.empty()) {
+            _buckets.emplace_back();
+        }
+        // otherwise a run of equal elements larger than that would trigger a rebuild on every push into it
+        _max_bucket_size = 4 * std::max(target, largest);
+        _min_window_size = n / 4;
+    }
+
+public:
+    sliding_kth_statistic(char const *name)
+    : _name(name), _buckets(1), _max_bucket_size(4 * min_bucket_size), _min_window_size(0),
+      _pushes(0), _rebuilds(0) {}
+
+    char const *name() const { return _name; }
+    size_t size() const { return _window.size(); }
+    // since the statistics were last reset
+    size_t rebuilds() const { return _rebuilds; }
+
+    void clear() {
+        _window.clear();
+        _bounds.clear();
+        _buckets.assign(1, std::vector<element_t>());
+        _max_bucket_size = 4 * min_bucket_size;
+        _min_window_size = 0;
+    }
+
+    // Adds an element to the back of the window
+    void push(element_t const &value) {
+        ++_pushes;
+        _window.push_back(value);
+        std::vector<element_t> &bucket = _buckets[bucket_of(value)];
+        bucket.insert(std::upper_bound(bucket.begin(), bucket.end(), value), value);
+        if (bucket.size() > _max_bucket_size) {
+            rebuild();
+        }
+    }
+
+    // Removes the element at the front of the window, which must not be empty
+    void pop() {
+        assert(!_window.empty());
+        element_t const &value = _window.front();
+        std::vector<element_t> &bucket = _buckets[bucket_of(value)];
+        bucket.erase(std::upper_bound(bucket.begin(), bucket.end(), value) - 1);
+        _window.pop_front();
+        if (_window.size() < _min_window_size) {
+            rebuild();
+        }
+    }
+
+    // The k-th order statistic of the window, k < size()
+    element_t const &query(size_t k) const {
+        assert(k < _window.size());
+        size_t bucket = 0;
+        while (k >= _buckets[bucket].size()) {
+            k -= _buckets[bucket].size();
+            ++bucket;
+        }
+        return _buckets[bucket][k];
+    }
+
+    void display_and_reset_statistics(std::ostream &out) {
+        out << "    [Pushes: " << _pushes
+            << ", rebuilds: " << _rebuilds
+            << ", buckets now: " << _buckets.size()
+            << "]" << std::endl;
+        _pushes = 0;
+        _rebuilds = 0;
+    }
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+/*
+ * A read-only memory mapping of a binary file, viewed as an array of elements.
+ * The file is expected to contain the raw elements in the native byte order,
+ * trailing bytes which do not form a whole element are ignored.
+ *
+ * POSIX only.
+ */
+
+#include <cstddef>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+template<typename element_t>
+class mapped_array {
+    int _fd;
+    void *_addr;
+    size_t _bytes;
+
+public:
+    mapped_array() : _fd(-1), _addr(nullptr), _bytes(0) {}
+    mapped_array(mapped_array const &) = delete;
+    mapped_array &operator = (mapped_array const &) = delete;
+
+    // Returns false on failure, errno tells the reason
+    bool open(char const *path) {
+        close();
+        _fd = ::open(path, O_RDONLY);
+        if (_fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(_fd, &st) != 0) {
+            close();
+            return false;
+        }
+        _bytes = size_t(st.st_size);
+        if (_bytes >= sizeof(element_t)) {
+            _addr = mmap(nullptr, _bytes, PROT_READ, MAP_SHARED, _fd, 0);
+            if (_addr == MAP_FAILED) {
+                _addr = nullptr;
+                close();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void close() {
+        if (_addr != nullptr) {
+            munmap(_addr, _bytes);
+            _addr = nullptr;
+        }
+        if (_fd >= 0) {
+            ::close(_fd);
+            _fd = -1;
+        }
+        _bytes = 0;
+    }
+
+    element_t const *data() const { return static_cast<element_t const *>(_addr); }
+    size_t size() const { return _bytes / sizeof(element_t); }
+    size_t bytes() const { return size() * sizeof(element_t); }
+
+    // Gives the kernel an access pattern hint for the elements [from, until), see madvise(2)
+    void advise(size_t from, size_t until, int advice) const {
+        if (_addr == nullptr || from >= until) {
+            return;
+        }
+        size_t page = size_t(sysconf(_SC_PAGESIZE));
+        size_t byte_from = from * sizeof(element_t) / page * page;
+        size_t byte_until = until * sizeof(element_t);
+        madvise(static_cast<char *>(_addr) + byte_from, byte_until - byte_from, advice);
+    }
+
+    ~mapped_array() {
+        close();
+    }
+};
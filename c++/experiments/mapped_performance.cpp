@@ -0,0 +1,106 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "kth_statistic_mapped.h"
+#include "kth_statistic_predictor_simple.h"
+#include "mapped_array.h"
+
+template<typename element_t, typename generator_t>
+void generate_file(std::string const &path, size_t size, generator_t generator) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    std::vector<element_t> chunk(size_t(1) << 20);
+    for (size_t done = 0; done < size; ) {
+        size_t count = std::min(chunk.size(), size - done);
+        for (size_t i = 0; i < count; ++i) {
+            chunk[i] = generator();
+        }
+        out.write(reinterpret_cast<char const *>(chunk.data()), std::streamsize(count * sizeof(element_t)));
+        done += count;
+    }
+    if (!out) {
+        std::cerr << "Error: cannot write " << size << " elements to " << path << std::endl;
+        std::exit(1);
+    }
+}
+
+template<typename element_t>
+void measure(char const *measurement_name, std::string const &path, size_t divisor, bool verify,
+             mapped_predicting_kth_statistic<element_t> &algorithm) {
+    mapped_array<element_t> arr;
+    if (!arr.open(path.c_str())) {
+        std::perror(path.c_str());
+        std::exit(1);
+    }
+    size_t size = arr.size();
+    size_t k = size / divisor;
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    element_t result = algorithm.find(arr, k);
+    const auto finish = std::chrono::high_resolution_clock::now();
+
+    if (verify) {
+        std::vector<element_t> copy(arr.data(), arr.data() + size);
+        std::nth_element(copy.begin(), copy.begin() + k, copy.end());
+        if (copy[k] != result) {
+            std::cerr << "Error: expected " << copy[k] << ", found " << result << std::endl;
+            std::exit(1);
+        }
+    }
+
+    const std::chrono::duration<double> elapsed_seconds(finish - start);
+    std::cout << "Measurement '" << measurement_name
+              << "', size = " << size
+              << ", k = " << k << ":" << std::endl;
+    std::cout << "    " << algorithm.name()
+              << ": " << std::setprecision(4) << std::scientific << elapsed_seconds
+              << ", " << std::setprecision(4) << std::fixed << arr.bytes() / elapsed_seconds.count() / 1e9
+              << " GB/s" << std::endl;
+    algorithm.display_and_reset_statistics(std::cout);
+}
+
+int main(int argc, char *argv[]) {
+    size_t size;
+    if (argc < 2 || argc > 3 || (size = std::strtoull(argv[1], nullptr, 10)) == 0) {
+        std::cerr << "Usage: " << argv[0] << " <number of elements> [<temporary file>]" << std::endl;
+        std::cerr << "    The temporary file is created, overwritten and removed; by default it is in "
+                  << std::filesystem::temp_directory_path() << std::endl;
+        std::exit(1);
+    }
+    std::string path = argc == 3 ? argv[2]
+                                 : (std::filesystem::temp_directory_path() / "kth_statistic_mapped.bin").string();
+    bool verify = size <= 100000000;
+
+    std::mt19937_64 rng(12314342342342LL);
+    tuned_ratio_sample_sizes tss;
+    std::vector<size_t> divisors = { 2, 10, 1000 };
+
+    mapped_predicting_kth_statistic<int64_t> mapped_int64(tss, "mapped predicting kth, tuned");
+    std::uniform_int_distribution<int64_t> int64_gen(-1000000000000000000LL, +1000000000000000000LL);
+    generate_file<int64_t>(path, size, [&] { return int64_gen(rng); });
+    for (size_t div : divisors) {
+        std::cout << "********* Int64, 1/" << div << " order stat **********\n" << std::endl;
+        measure<int64_t>("UniformInt64[-1e18, +1e18]", path, div, verify, mapped_int64);
+        std::cout << std::endl;
+    }
+
+    mapped_predicting_kth_statistic<double> mapped_dbl(tss, "mapped predicting kth, tuned");
+    std::uniform_real_distribution<double> dbl_gen(-1.0, +1.0);
+    generate_file<double>(path, size, [&] { return dbl_gen(rng); });
+    for (size_t div : divisors) {
+        std::cout << "********* Double, 1/" << div << " order stat **********\n" << std::endl;
+        measure<double>("UniformDouble[-1, +1]", path, div, verify, mapped_dbl);
+        std::cout << std::endl;
+    }
+
+    std::remove(path.c_str());
+    return 0;
+}
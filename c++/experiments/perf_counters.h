@@ -0,0 +1,151 @@
+#pragma once
+
+/*
+ * Hardware performance counters for the benchmarks, using perf_event_open(2).
+ *
+ * Every event is opened on its own, so that the ones which the CPU or the kernel do not support
+ * are simply missing. If none can be opened (not Linux, no PMU in a virtual machine,
+ * or a restrictive /proc/sys/kernel/perf_event_paranoid, as is common in containers),
+ * available() is false and the benchmarks report only time.
+ *
+ * The counters follow the thread which creates them, and the threads which it starts afterwards,
+ * so they should be created before any thread pool. Only user-space events are counted.
+ * When there are more events than hardware counters, the kernel multiplexes them,
+ * and the values are scaled by the fraction of time the event was actually counted.
+ */
+
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+class perf_counters {
+public:
+    static constexpr size_t n_events = 6;
+
+private:
+    int _fds[n_events];
+    double _values[n_events];
+
+    static char const *event_name(size_t event) {
+        static char const *names[n_events] = {
+            "cycles", "instructions", "branch-misses", "L1D misses", "LLC misses", "dTLB misses"
+        };
+        return names[event];
+    }
+
+#ifdef __linux__
+    static int open_event(uint32_t type, uint64_t config) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+
+    static uint64_t cache_miss(uint64_t cache) {
+        return cache | (uint64_t(PERF_COUNT_HW_CACHE_OP_READ) << 8) | (uint64_t(PERF_COUNT_HW_CACHE_RESULT_MISS) << 16);
+    }
+#endif
+
+public:
+    perf_counters() {
+        for (size_t i = 0; i < n_events; ++i) {
+            _fds[i] = -1;
+            _values[i] = 0;
+        }
+#ifdef __linux__
+        _fds[0] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        _fds[1] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        _fds[2] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+        _fds[3] = open_event(PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_L1D));
+        _fds[4] = open_event(PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_LL));
+        _fds[5] = open_event(PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_DTLB));
+#endif
+    }
+
+    perf_counters(perf_counters const &) = delete;
+    perf_counters &operator = (perf_counters const &) = delete;
+
+    ~perf_counters() {
+#ifdef __linux__
+        for (size_t i = 0; i < n_events; ++i) {
+            if (_fds[i] >= 0) {
+                close(_fds[i]);
+            }
+        }
+#endif
+    }
+
+    bool available() const {
+        for (size_t i = 0; i < n_events; ++i) {
+            if (_fds[i] >= 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void start() {
+#ifdef __linux__
+        for (size_t i = 0; i < n_events; ++i) {
+            if (_fds[i] >= 0) {
+                ioctl(_fds[i], PERF_EVENT_IOC_RESET, 0);
+                ioctl(_fds[i], PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    void stop() {
+#ifdef __linux__
+        for (size_t i = 0; i < n_events; ++i) {
+            _values[i] = 0;
+            if (_fds[i] >= 0) {
+                ioctl(_fds[i], PERF_EVENT_IOC_DISABLE, 0);
+                // value, time enabled, time running
+                uint64_t data[3] = { 0, 0, 0 };
+                if (read(_fds[i], data, sizeof(data)) == ssize_t(sizeof(data)) && data[2] > 0) {
+                    _values[i] = double(data[0]) * double(data[1]) / double(data[2]);
+                }
+            }
+        }
+#endif
+    }
+
+    // The value of the event between the last start() and stop(), or a negative number if it is not available
+    double value(size_t event) const {
+        return _fds[event] >= 0 ? _values[event] : -1;
+    }
+
+    // Prints the available counters, both in total and per element, on a single line
+    void print(std::ostream &out, double n_elements) const {
+        if (!available()) {
+            return;
+        }
+        out << "        [";
+        bool first = true;
+        for (size_t i = 0; i < n_events; ++i) {
+            if (_fds[i] >= 0) {
+                out << (first ? "" : ", ") << event_name(i) << ": "
+                    << std::setprecision(4) << std::scientific << _values[i]
+                    << " (" << std::setprecision(4) << std::fixed << _values[i] / n_elements << " per element)";
+                first = false;
+            }
+        }
+        out << "]" << std::endl;
+    }
+};
@@ -1,22 +1,32 @@
+#include <algorithm>
 #include <chrono>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <iomanip>
+#include <memory>
 #include <random>
+#include <thread>
 #include <vector>
 
 #include "kth_statistic.h"
 #include "kth_statistic_stl.h"
 #include "kth_statistic_hoare.h"
+#include "kth_statistic_floyd_rivest.h"
 #include "kth_statistic_predictor_simple.h"
+#include "kth_statistic_predictor_destructive.h"
+#include "kth_statistic_predictor_parallel.h"
+#include "kth_statistic_radix.h"
+#include "kth_statistic_argselect.h"
+#include "kth_statistic_predictor_argselect.h"
+#include "kth_statistic_batch.h"
+#include "perf_counters.h"
+#include "generators.h"
 #include "util.h"
+#include "workspace.h"
 
-template<typename element_t>
-struct sequence_changer {
-    virtual void generate(element_t *array, size_t size) = 0;
-    virtual ~sequence_changer() {}
-};
+// Created before main, and thus before the thread pool, so that its threads are also counted
+perf_counters counters;
 
 template<typename element_t>
 class performance_test {
@@ -62,11 +72,13 @@ public:
                 array_copy(reference[i], size, working[i]);
             }
 
+            counters.start();
             const auto start = std::chrono::high_resolution_clock::now();
             for (size_t i = 0; i < count; ++i) {
                 results[i] = algorithm->find(working[i], size, k);
             }
             const auto finish = std::chrono::high_resolution_clock::now();
+            counters.stop();
 
             int hash = 0;
             for (size_t i = 1; i < count; ++i) {
@@ -90,6 +102,154 @@ public:
                       << ": " << std::setprecision(4) << std::scientific << elapsed_seconds
                       << ", " << std::setprecision(4) << std::scientific << normalized
                       << " per element" << std::endl;
+            counters.print(std::cout, double(size) * double(count));
+            algorithm->display_and_reset_statistics(std::cout);
+        }
+    }
+
+    void test_many(std::vector< kth_statistic<element_t>* > algorithms, std::vector<size_t> const &ks) {
+        std::cout << "Measurement '" << measurement_name
+                  << "', size = " << size
+                  << ", ks = [";
+        for (size_t i = 0; i < ks.size(); ++i) {
+            std::cout << (i == 0 ? "" : ", ") << ks[i];
+        }
+        std::cout << "], count = " << count
+                  << ":" << std::endl;
+
+        size_t algo_width = 0;
+        for (auto algorithm : algorithms) {
+            algo_width = std::max(algo_width, strlen(algorithm->name()));
+        }
+
+        std::vector<element_t> many_results(count * ks.size()), expected_results;
+
+        for (kth_statistic<element_t> *algorithm : algorithms) {
+            algorithm->resize(size);
+            for (size_t i = 0; i < count; ++i) {
+                array_copy(reference[i], size, working[i]);
+            }
+
+            counters.start();
+            const auto start = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < count; ++i) {
+                algorithm->find_many(working[i], size, ks.data(), ks.size(), many_results.data() + i * ks.size());
+            }
+            const auto finish = std::chrono::high_resolution_clock::now();
+            counters.stop();
+
+            if (expected_results.empty()) {
+                expected_results = many_results;
+            } else if (expected_results != many_results) {
+                std::cerr << "Error: results are different between " << algorithms[0]->name()
+                          << " and " << algorithm->name() << std::endl;
+                std::exit(1);
+            }
+
+            const std::chrono::duration<double> elapsed_seconds(finish - start);
+            const std::chrono::duration<double> normalized = elapsed_seconds / double(size) / double(count);
+
+            std::cout << "    " << std::setw(algo_width) << algorithm->name()
+                      << ": " << std::setprecision(4) << std::scientific << elapsed_seconds
+                      << ", " << std::setprecision(4) << std::scientific << normalized
+                      << " per element" << std::endl;
+            counters.print(std::cout, double(size) * double(count));
+        }
+    }
+
+    // The same for partition_at, which is checked after the timing
+    void test_partition(std::vector< kth_statistic<element_t>* > algorithms) {
+        std::cout << "Measurement '" << measurement_name
+                  << "', size = " << size
+                  << ", k = " << k
+                  << ", count = " << count
+                  << ", partition:" << std::endl;
+
+        size_t algo_width = 0;
+        for (auto algorithm : algorithms) {
+            algo_width = std::max(algo_width, strlen(algorithm->name()));
+        }
+
+        for (kth_statistic<element_t> *algorithm : algorithms) {
+            algorithm->resize(size);
+            for (size_t i = 0; i < count; ++i) {
+                array_copy(reference[i], size, working[i]);
+            }
+
+            counters.start();
+            const auto start = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < count; ++i) {
+                algorithm->partition_at(working[i], size, k);
+            }
+            const auto finish = std::chrono::high_resolution_clock::now();
+            counters.stop();
+
+            for (size_t i = 0; i < count; ++i) {
+                element_t const *arr = working[i];
+                if (std::any_of(arr, arr + k, [&](element_t x) { return arr[k] < x; })
+                    || std::any_of(arr + k, arr + size, [&](element_t x) { return x < arr[k]; })) {
+                    std::cerr << "Error: " << algorithm->name() << " did not partition the array" << std::endl;
+                    std::exit(1);
+                }
+            }
+
+            const std::chrono::duration<double> elapsed_seconds(finish - start);
+            const std::chrono::duration<double> normalized = elapsed_seconds / double(size) / double(count);
+
+            std::cout << "    " << std::setw(algo_width) << algorithm->name()
+                      << ": " << std::setprecision(4) << std::scientific << elapsed_seconds
+                      << ", " << std::setprecision(4) << std::scientific << normalized
+                      << " per element" << std::endl;
+            counters.print(std::cout, double(size) * double(count));
+            algorithm->display_and_reset_statistics(std::cout);
+        }
+    }
+
+    // The same for find_batch over all the arrays at once, where the engines without their own
+    // find_batch call find for every array
+    void test_batch(std::vector< kth_statistic<element_t>* > algorithms) {
+        std::cout << "Measurement '" << measurement_name
+                  << "', size = " << size
+                  << ", k = " << k
+                  << ", count = " << count
+                  << ", batch:" << std::endl;
+
+        size_t algo_width = 0;
+        for (auto algorithm : algorithms) {
+            algo_width = std::max(algo_width, strlen(algorithm->name()));
+        }
+
+        std::vector<element_t> expected_results;
+
+        for (kth_statistic<element_t> *algorithm : algorithms) {
+            algorithm->resize(size);
+            for (size_t i = 0; i < count; ++i) {
+                array_copy(reference[i], size, working[i]);
+            }
+
+            counters.start();
+            const auto start = std::chrono::high_resolution_clock::now();
+            algorithm->find_batch(working, count, size, k, results);
+            const auto finish = std::chrono::high_resolution_clock::now();
+            counters.stop();
+
+            if (expected_results.empty()) {
+                expected_results.assign(results, results + count);
+            } else if (!std::equal(expected_results.begin(), expected_results.end(), results)) {
+                std::cerr << "Error: results are different between " << algorithms[0]->name()
+                          << " and " << algorithm->name() << std::endl;
+                std::exit(1);
+            }
+
+            const std::chrono::duration<double> elapsed_seconds(finish - start);
+            const std::chrono::duration<double> normalized = elapsed_seconds / double(size) / double(count);
+
+            std::cout << "    " << std::setw(algo_width) << algorithm->name()
+                      << ": " << std::setprecision(4) << std::scientific << elapsed_seconds
+                      << ", " << std::setprecision(4) << std::scientific << normalized
+                      << " per element" << std::endl;
+            counters.print(std::cout, double(size) * double(count));
+            algorithm->display_and_reset_statistics(std::cout);
         }
     }
 
@@ -104,66 +264,149 @@ public:
     }
 };
 
-template<typename element_t, typename rng_t>
-struct uniform_int_generator : sequence_changer<element_t> {
-    rng_t &rng;
-    element_t min, max;
+// A record of the given size which is ordered by its first field
+template<size_t bytes>
+struct record {
+    double key;
+    char payload[bytes - sizeof(double)];
 
-    uniform_int_generator(rng_t &rng, element_t min, element_t max): rng(rng), min(min), max(max) {}
+    auto operator <=> (record const &that) const { return key <=> that.key; }
+    bool operator == (record const &that) const { return key == that.key; }
+};
 
-    void generate(element_t *array, size_t size) {
-        std::uniform_int_distribution<element_t> value_gen(min, max);
-        for (size_t i = 0; i < size; ++i) {
-            array[i] = value_gen(rng);
-        }
+/*
+ * Selecting records by key: algorithms which move the records around,
+ * and argselect algorithms which project the keys to a separate column and leave the records alone.
+ */
+template<size_t bytes>
+void test_records(char const *measurement_name, size_t size, size_t count, std::mt19937_64 &rng,
+                  std::vector< kth_statistic< record<bytes> >* > const &algorithms,
+                  std::vector< kth_argselect<double>* > const &argselects) {
+    typedef record<bytes> record_t;
+    size_t k = size / 2;
+    std::cout << "Measurement '" << measurement_name
+              << "', record size = " << sizeof(record_t)
+              << ", size = " << size
+              << ", k = " << k
+              << ", count = " << count
+              << ":" << std::endl;
+
+    std::uniform_real_distribution<double> key_gen(-1.0, +1.0);
+    std::vector<record_t> reference(size * count), working(size * count);
+    for (record_t &r : reference) {
+        r.key = key_gen(rng);
+        std::fill(r.payload, r.payload + sizeof(r.payload), char(0));
     }
-};
+    std::vector<double> key_column(size), expected_keys, keys(count);
 
-template<typename element_t, typename rng_t>
-struct uniform_real_generator : sequence_changer<element_t> {
-    rng_t &rng;
-    element_t min, max;
+    size_t algo_width = 0;
+    for (auto algorithm : algorithms) {
+        algo_width = std::max(algo_width, strlen(algorithm->name()));
+    }
+    for (auto algorithm : argselects) {
+        algo_width = std::max(algo_width, strlen(algorithm->name()));
+    }
 
-    uniform_real_generator(rng_t &rng, element_t min, element_t max): rng(rng), min(min), max(max) {}
+    auto report = [&](char const *name, std::chrono::duration<double> const &elapsed_seconds) {
+        if (expected_keys.empty()) {
+            expected_keys = keys;
+        } else if (expected_keys != keys) {
+            std::cerr << "Error: results are different between " << algorithms[0]->name()
+                      << " and " << name << std::endl;
+            std::exit(1);
+        }
+        const std::chrono::duration<double> normalized = elapsed_seconds / double(size) / double(count);
+        std::cout << "    " << std::setw(algo_width) << name
+                  << ": " << std::setprecision(4) << std::scientific << elapsed_seconds
+                  << ", " << std::setprecision(4) << std::scientific << normalized
+                  << " per element" << std::endl;
+        counters.print(std::cout, double(size) * double(count));
+    };
 
-    void generate(element_t *array, size_t size) {
-        std::uniform_real_distribution<element_t> value_gen(min, max);
-        for (size_t i = 0; i < size; ++i) {
-            array[i] = value_gen(rng);
+    for (kth_statistic<record_t> *algorithm : algorithms) {
+        algorithm->resize(size);
+        working = reference;
+        counters.start();
+        const auto start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < count; ++i) {
+            keys[i] = algorithm->find(working.data() + i * size, size, k).key;
         }
+        const auto finish = std::chrono::high_resolution_clock::now();
+        counters.stop();
+        report(algorithm->name(), finish - start);
     }
-};
-
-template<typename element_t, typename comparator_t>
-struct sorter : sequence_changer<element_t> {
-    comparator_t cmp;
 
-    void generate(element_t *array, size_t size) {
-        std::sort(array, array + size, cmp);
+    for (kth_argselect<double> *algorithm : argselects) {
+        algorithm->resize(size);
+        counters.start();
+        const auto start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < count; ++i) {
+            keys[i] = algorithm->find_record(reference.data() + i * size, size, k,
+                                             &record_t::key, key_column.data()).key;
+        }
+        const auto finish = std::chrono::high_resolution_clock::now();
+        counters.stop();
+        report(algorithm->name(), finish - start);
     }
-};
+}
 
-int main() {
+int main(int argc, char *argv[]) {
+    if (argc > 3 || (argc == 3 && std::strcmp(argv[2], "int") != 0 && std::strcmp(argv[2], "double") != 0)) {
+        std::cerr << "Usage: " << argv[0] << " [<binary file to replay> [int | double; default double]]" << std::endl;
+        std::exit(1);
+    }
     std::mt19937_64 rng(12314342342342LL);
 
+    if (!counters.available()) {
+        std::cout << "Hardware performance counters are not available, reporting time only\n" << std::endl;
+    }
+
     fixed_ratio_sample_sizes fss(10, 10);
     tuned_ratio_sample_sizes tss;
+    tuned_ratio_policy trp;
+    thread_pool pool(std::max(1u, std::thread::hardware_concurrency()));
 
     stl_kth_statistic<int> stl_int;
     bidirectional_hoare_middle<int> hoare_mid_int;
+    introspective_hoare<int> intro_int;
+    floyd_rivest_kth_statistic<int> floyd_rivest_int;
+    floyd_rivest_aux_kth_statistic<int> floyd_rivest_aux_int;
     predicting_kth_statistic<int> predicting_int_fixed(fss, "simple predicting kth, fixed");
     predicting_kth_statistic<int> predicting_int_tuned(tss, "simple predicting kth, tuned");
-
-    std::vector< kth_statistic<int>* > all_int { &stl_int, &hoare_mid_int,
-                                                 &predicting_int_fixed, &predicting_int_tuned };
+    predicting_kth_statistic<int, tuned_ratio_policy> predicting_int_policy(trp, "simple predicting kth, tuned policy");
+    destructive_predicting_kth_statistic<int> destructive_int_tuned(tss, "destructive predicting kth, tuned");
+    predicting_kth_statistic<int> recursive_int_fixed(fss, "recursive predicting kth, fixed, depth 2", 1, 2);
+    predicting_kth_statistic<int> recursive_int_tuned(tss, "recursive predicting kth, tuned, depth 2", 1, 2);
+    parallel_predicting_kth_statistic<int> parallel_int_tuned(tss, pool, "parallel predicting kth, tuned");
+    radix_kth_statistic<int, 8> radix_int_8("radix select, 8-bit digits");
+    radix_kth_statistic<int, 11> radix_int_11("radix select, 11-bit digits");
+
+    std::vector< kth_statistic<int>* > all_int { &stl_int, &hoare_mid_int, &intro_int,
+                                                 &floyd_rivest_int, &floyd_rivest_aux_int,
+                                                 &predicting_int_fixed, &predicting_int_tuned, &predicting_int_policy, &destructive_int_tuned,
+                                                 &recursive_int_fixed, &recursive_int_tuned,
+                                                 &parallel_int_tuned, &radix_int_8, &radix_int_11 };
 
     stl_kth_statistic<double> stl_dbl;
     bidirectional_hoare_middle<double> hoare_mid_dbl;
+    introspective_hoare<double> intro_dbl;
+    floyd_rivest_kth_statistic<double> floyd_rivest_dbl;
+    floyd_rivest_aux_kth_statistic<double> floyd_rivest_aux_dbl;
     predicting_kth_statistic<double> predicting_dbl_fixed(fss, "simple predicting kth, fixed");
     predicting_kth_statistic<double> predicting_dbl_tuned(tss, "simple predicting kth, tuned");
-
-    std::vector< kth_statistic<double>* > all_dbl { &stl_dbl, &hoare_mid_dbl,
-                                                 &predicting_dbl_fixed, &predicting_dbl_tuned };
+    predicting_kth_statistic<double, tuned_ratio_policy> predicting_dbl_policy(trp, "simple predicting kth, tuned policy");
+    destructive_predicting_kth_statistic<double> destructive_dbl_tuned(tss, "destructive predicting kth, tuned");
+    predicting_kth_statistic<double> recursive_dbl_fixed(fss, "recursive predicting kth, fixed, depth 2", 1, 2);
+    predicting_kth_statistic<double> recursive_dbl_tuned(tss, "recursive predicting kth, tuned, depth 2", 1, 2);
+    parallel_predicting_kth_statistic<double> parallel_dbl_tuned(tss, pool, "parallel predicting kth, tuned");
+    radix_kth_statistic<double, 8> radix_dbl_8("radix select, 8-bit digits");
+    radix_kth_statistic<double, 11> radix_dbl_11("radix select, 11-bit digits");
+
+    std::vector< kth_statistic<double>* > all_dbl { &stl_dbl, &hoare_mid_dbl, &intro_dbl,
+                                                 &floyd_rivest_dbl, &floyd_rivest_aux_dbl,
+                                                 &predicting_dbl_fixed, &predicting_dbl_tuned, &predicting_dbl_policy, &destructive_dbl_tuned,
+                                                 &recursive_dbl_fixed, &recursive_dbl_tuned,
+                                                 &parallel_dbl_tuned, &radix_dbl_8, &radix_dbl_11 };
 
     uniform_int_generator<int, std::mt19937_64> gen_int_1(rng, -1000000000, +1000000000);
     uniform_real_generator<double, std::mt19937_64> gen_dbl_1(rng, -1.0, +1.0);
@@ -171,17 +414,67 @@ int main() {
     sorter<int, std::greater<int> > int_decreasing_sorter;
     sorter<double, std::less<double> > dbl_increasing_sorter;
     sorter<double, std::greater<double> > dbl_decreasing_sorter;
+    few_unique_generator<int, std::mt19937_64> gen_int_few(rng, 10);
+    few_unique_generator<double, std::mt19937_64> gen_dbl_few(rng, 10);
+    zipf_generator<int, std::mt19937_64> gen_int_zipf(rng, 10000, 1.1);
+    zipf_generator<double, std::mt19937_64> gen_dbl_zipf(rng, 10000, 1.1);
+    stride_periodic_generator<int, std::mt19937_64> gen_int_stride(rng, tss, 1000000);
+    stride_periodic_generator<double, std::mt19937_64> gen_dbl_stride(rng, tss, 1.0);
+    organ_pipe<int> int_organ_pipe;
+    organ_pipe<double> dbl_organ_pipe;
+    shuffler<int, std::mt19937_64> int_shuffler(rng);
+    shuffler<double, std::mt19937_64> dbl_shuffler(rng);
+    sawtooth<int> int_sawtooth(16);
+    sawtooth<double> dbl_sawtooth(16);
+    random_swapper<int, std::mt19937_64> int_swapper(rng, 1);
+    random_swapper<double, std::mt19937_64> dbl_swapper(rng, 1);
 
     std::vector< std::pair< char const *, std::vector< sequence_changer<int>* > > > int_tests = {
         { "UniformInt[-1e9, +1e9]", { &gen_int_1 } },
         { "UniformIntInc[-1e9, +1e9]", { &gen_int_1, &int_increasing_sorter } },
-        { "UniformIntDec[-1e9, +1e9]", { &gen_int_1, &int_decreasing_sorter } }
+        { "UniformIntDec[-1e9, +1e9]", { &gen_int_1, &int_decreasing_sorter } },
+        { "FewUniqueInt[10]", { &gen_int_few } },
+        { "ZipfInt[1e4, 1.1]", { &gen_int_zipf } },
+        { "SawtoothInt[-1e9, +1e9, 16 teeth]", { &gen_int_1, &int_sawtooth } },
+        { "NearlySortedInt[-1e9, +1e9, 1% swaps]", { &gen_int_1, &int_increasing_sorter, &int_swapper } },
+        { "StridePeriodicInt[tuned stride]", { &gen_int_stride } },
+        { "ShuffledStridePeriodicInt[tuned stride]", { &gen_int_stride, &int_shuffler } },
+        { "OrganPipeInt[-1e9, +1e9]", { &gen_int_1, &int_organ_pipe } }
     };
 
     std::vector< std::pair< char const *, std::vector< sequence_changer<double>* > > > dbl_tests = {
         { "UniformDouble[-1, +1]", { &gen_dbl_1 } },
         { "UniformDoubleInc[-1, +1]", { &gen_dbl_1, &dbl_increasing_sorter } },
-        { "UniformDoubleDec[-1, +1]", { &gen_dbl_1, &dbl_decreasing_sorter } }
+        { "UniformDoubleDec[-1, +1]", { &gen_dbl_1, &dbl_decreasing_sorter } },
+        { "FewUniqueDouble[10]", { &gen_dbl_few } },
+        { "ZipfDouble[1e4, 1.1]", { &gen_dbl_zipf } },
+        { "SawtoothDouble[-1, +1, 16 teeth]", { &gen_dbl_1, &dbl_sawtooth } },
+        { "NearlySortedDouble[-1, +1, 1% swaps]", { &gen_dbl_1, &dbl_increasing_sorter, &dbl_swapper } },
+        { "StridePeriodicDouble[tuned stride]", { &gen_dbl_stride } },
+        { "ShuffledStridePeriodicDouble[tuned stride]", { &gen_dbl_stride, &dbl_shuffler } },
+        { "OrganPipeDouble[-1, +1]", { &gen_dbl_1, &dbl_organ_pipe } }
+    };
+
+    std::unique_ptr< file_replayer<int> > int_replayer;
+    std::unique_ptr< file_replayer<double> > dbl_replayer;
+    if (argc == 3 && std::strcmp(argv[2], "int") == 0) {
+        int_replayer.reset(new file_replayer<int>(argv[1]));
+        int_tests.push_back({ "ReplayedInt", { int_replayer.get() } });
+    } else if (argc >= 2) {
+        dbl_replayer.reset(new file_replayer<double>(argv[1]));
+        dbl_tests.push_back({ "ReplayedDouble", { dbl_replayer.get() } });
+    }
+
+    // the organ pipes take quadratic time for the middle-pivot Hoare selection, see its own section below
+    std::vector< kth_statistic<int>* > all_int_but_hoare(all_int);
+    std::erase(all_int_but_hoare, &hoare_mid_int);
+    std::vector< kth_statistic<double>* > all_dbl_but_hoare(all_dbl);
+    std::erase(all_dbl_but_hoare, &hoare_mid_dbl);
+    auto int_engines_for = [&](std::vector< sequence_changer<int>* > const &changers) {
+        return std::count(changers.begin(), changers.end(), &int_organ_pipe) > 0 ? all_int_but_hoare : all_int;
+    };
+    auto dbl_engines_for = [&](std::vector< sequence_changer<double>* > const &changers) {
+        return std::count(changers.begin(), changers.end(), &dbl_organ_pipe) > 0 ? all_dbl_but_hoare : all_dbl;
     };
 
     std::vector<size_t> divisors = { 2, 10 };
@@ -191,7 +484,7 @@ int main() {
         for (auto config : int_tests) {
             for (size_t i = 1, s = 10; i <= 7; ++i, s *= 10) {
                 performance_test<int> test(config.first, s, s / div, 100000000 / s, config.second);
-                test.test(all_int);
+                test.test(int_engines_for(config.second));
             }
             std::cout << std::endl;
         }
@@ -201,11 +494,172 @@ int main() {
         for (auto config : dbl_tests) {
             for (size_t i = 1, s = 10; i <= 7; ++i, s *= 10) {
                 performance_test<double> test(config.first, s, s / div, 100000000 / s, config.second);
-                test.test(all_dbl);
+                test.test(dbl_engines_for(config.second));
             }
             std::cout << std::endl;
         }
     }
 
+    std::cout << "********* Int, percentiles 1, 5, 50, 95, 99 **********\n" << std::endl;
+
+    for (auto config : int_tests) {
+        for (size_t i = 1, s = 10; i <= 7; ++i, s *= 10) {
+            performance_test<int> test(config.first, s, 0, 100000000 / s, config.second);
+            test.test_many(int_engines_for(config.second), { s / 100, s / 20, s / 2, s - s / 20 - 1, s - s / 100 - 1 });
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout << "********* Double, percentiles 1, 5, 50, 95, 99 **********\n" << std::endl;
+
+    for (auto config : dbl_tests) {
+        for (size_t i = 1, s = 10; i <= 7; ++i, s *= 10) {
+            performance_test<double> test(config.first, s, 0, 100000000 / s, config.second);
+            test.test_many(dbl_engines_for(config.second), { s / 100, s / 20, s / 2, s - s / 20 - 1, s - s / 100 - 1 });
+        }
+        std::cout << std::endl;
+    }
+
+    // the engines which do not override partition_at are left out, as they would be std::nth_element again
+    std::cout << "********* Int, partition at 1/2 **********\n" << std::endl;
+
+    for (auto config : int_tests) {
+        for (size_t i = 1, s = 10; i <= 7; ++i, s *= 10) {
+            performance_test<int> test(config.first, s, s / 2, 100000000 / s, config.second);
+            test.test_partition({ &stl_int, &intro_int, &floyd_rivest_int,
+                                  &predicting_int_tuned, &predicting_int_policy, &recursive_int_tuned });
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout << "********* Double, partition at 1/2 **********\n" << std::endl;
+
+    for (auto config : dbl_tests) {
+        for (size_t i = 1, s = 10; i <= 7; ++i, s *= 10) {
+            performance_test<double> test(config.first, s, s / 2, 100000000 / s, config.second);
+            test.test_partition({ &stl_dbl, &intro_dbl, &floyd_rivest_dbl,
+                                  &predicting_dbl_tuned, &predicting_dbl_policy, &recursive_dbl_tuned });
+        }
+        std::cout << std::endl;
+    }
+
+    // the hit and miss counts of every strategy are in the statistics below each time
+    std::cout << "********* Int, sampling strategies, 1/2 order stat **********\n" << std::endl;
+
+    predicting_kth_statistic<int, tuned_ratio_policy, random_sampling> random_int_policy(trp, "simple predicting kth, tuned policy, random sampling");
+    predicting_kth_statistic<int, tuned_ratio_policy, block_sampling> blocks_int_policy(trp, "simple predicting kth, tuned policy, block sampling");
+    for (auto config : int_tests) {
+        for (size_t i = 3, s = 1000; i <= 7; ++i, s *= 10) {
+            performance_test<int> test(config.first, s, s / 2, 100000000 / s, config.second);
+            test.test({ &predicting_int_policy, &random_int_policy, &blocks_int_policy });
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout << "********* Double, sampling strategies, 1/2 order stat **********\n" << std::endl;
+
+    predicting_kth_statistic<double, tuned_ratio_policy, random_sampling> random_dbl_policy(trp, "simple predicting kth, tuned policy, random sampling");
+    predicting_kth_statistic<double, tuned_ratio_policy, block_sampling> blocks_dbl_policy(trp, "simple predicting kth, tuned policy, block sampling");
+    for (auto config : dbl_tests) {
+        for (size_t i = 3, s = 1000; i <= 7; ++i, s *= 10) {
+            performance_test<double> test(config.first, s, s / 2, 100000000 / s, config.second);
+            test.test({ &predicting_dbl_policy, &random_dbl_policy, &blocks_dbl_policy });
+        }
+        std::cout << std::endl;
+    }
+
+    // the batched engine against a find for every array, by the engine which it passes the rest to and by others
+    std::cout << "********* Int, batches of small arrays, 1/2 order stat **********\n" << std::endl;
+
+    network_kth_statistic<int> network_int;
+    batched_kth_statistic<int> batched_int(predicting_int_policy, "batched, on simple predicting kth, tuned policy");
+    for (auto config : int_tests) {
+        for (size_t s : { 10, 30, 100, 300, 1000 }) {
+            performance_test<int> test(config.first, s, s / 2, 100000000 / s, config.second);
+            test.test_batch({ &stl_int, &network_int, &predicting_int_policy, &batched_int });
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout << "********* Double, batches of small arrays, 1/2 order stat **********\n" << std::endl;
+
+    network_kth_statistic<double> network_dbl;
+    batched_kth_statistic<double> batched_dbl(predicting_dbl_policy, "batched, on simple predicting kth, tuned policy");
+    for (auto config : dbl_tests) {
+        for (size_t s : { 10, 30, 100, 300, 1000 }) {
+            performance_test<double> test(config.first, s, s / 2, 100000000 / s, config.second);
+            test.test_batch({ &stl_dbl, &network_dbl, &predicting_dbl_policy, &batched_dbl });
+        }
+        std::cout << std::endl;
+    }
+
+    // quadratic for bidirectional Hoare, hence the smaller sizes
+    std::cout << "********* Adversarial for middle-pivot Hoare, 1/2 order stat **********\n" << std::endl;
+
+    hoare_middle_killer<int> int_killer(2);
+    std::vector< std::pair< char const *, std::vector< sequence_changer<int>* > > > hoare_adversarial_tests = {
+        { "HoareMiddleKillerInt", { &int_killer } },
+        { "OrganPipeInt[-1e9, +1e9]", { &gen_int_1, &int_organ_pipe } }
+    };
+    for (auto config : hoare_adversarial_tests) {
+        for (size_t i = 1, s = 10; i <= 4; ++i, s *= 10) {
+            performance_test<int> test(config.first, s, s / 2, 1000000 / s, config.second);
+            test.test(all_int);
+        }
+        // only the algorithms which stay linear
+        for (size_t i = 5, s = 100000; i <= 7; ++i, s *= 10) {
+            performance_test<int> test(config.first, s, s / 2, 100000000 / s, config.second);
+            test.test({ &stl_int, &intro_int, &floyd_rivest_int, &floyd_rivest_aux_int,
+                        &predicting_int_tuned, &radix_int_11 });
+        }
+        std::cout << std::endl;
+    }
+
+    // the workspaces are shared by the engines of both types, as they are used one at a time
+    std::cout << "********* Workspace pages, 4K vs huge, 1/2 order stat **********\n" << std::endl;
+
+    workspace small_pages(page_policy::small_pages), huge_pages(page_policy::huge_pages);
+    predicting_kth_statistic<int> predicting_int_4k(tss, "simple predicting kth, tuned, 4K pages", 1, 0, &small_pages);
+    predicting_kth_statistic<int> predicting_int_huge(tss, "simple predicting kth, tuned, huge pages", 1, 0, &huge_pages);
+    radix_kth_statistic<int, 11> radix_int_4k("radix select, 11-bit digits, 4K pages", 1, &small_pages);
+    radix_kth_statistic<int, 11> radix_int_huge("radix select, 11-bit digits, huge pages", 1, &huge_pages);
+    predicting_kth_statistic<double> predicting_dbl_4k(tss, "simple predicting kth, tuned, 4K pages", 1, 0, &small_pages);
+    predicting_kth_statistic<double> predicting_dbl_huge(tss, "simple predicting kth, tuned, huge pages", 1, 0, &huge_pages);
+    radix_kth_statistic<double, 11> radix_dbl_4k("radix select, 11-bit digits, 4K pages", 1, &small_pages);
+    radix_kth_statistic<double, 11> radix_dbl_huge("radix select, 11-bit digits, huge pages", 1, &huge_pages);
+
+    for (size_t s = 10000000; s <= 100000000; s *= 10) {
+        performance_test<int> test("UniformInt[-1e9, +1e9]", s, s / 2, 100000000 / s, { &gen_int_1 });
+        test.test({ &predicting_int_4k, &predicting_int_huge, &radix_int_4k, &radix_int_huge });
+    }
+    std::cout << std::endl;
+    for (size_t s = 10000000; s <= 100000000; s *= 10) {
+        performance_test<double> test("UniformDouble[-1, +1]", s, s / 2, 100000000 / s, { &gen_dbl_1 });
+        test.test({ &predicting_dbl_4k, &predicting_dbl_huge, &radix_dbl_4k, &radix_dbl_huge });
+    }
+    std::cout << "    [Huge pages in use: " << huge_pages.huge_page_bytes() / (1 << 20) << " of "
+              << huge_pages.capacity() / (1 << 20) << " MiB]" << std::endl;
+    std::cout << std::endl;
+
+    std::cout << "********* Records, median by key **********\n" << std::endl;
+
+    stl_kth_statistic< record<16> > stl_rec_16;
+    predicting_kth_statistic< record<16>, tuned_ratio_policy > predicting_rec_16(trp, "simple predicting kth, tuned policy");
+    stl_kth_statistic< record<64> > stl_rec_64;
+    predicting_kth_statistic< record<64>, tuned_ratio_policy > predicting_rec_64(trp, "simple predicting kth, tuned policy");
+    stl_argselect<double> stl_arg;
+    predicting_argselect<double, tuned_ratio_policy> predicting_arg(trp, "simple predicting argselect, tuned policy");
+
+    for (size_t i = 2, s = 100; i <= 6; ++i, s *= 10) {
+        test_records<16>("UniformDouble[-1, +1] key", s, 2000000 / s, rng,
+                         { &stl_rec_16, &predicting_rec_16 }, { &stl_arg, &predicting_arg });
+    }
+    std::cout << std::endl;
+    for (size_t i = 2, s = 100; i <= 6; ++i, s *= 10) {
+        test_records<64>("UniformDouble[-1, +1] key", s, 2000000 / s, rng,
+                         { &stl_rec_64, &predicting_rec_64 }, { &stl_arg, &predicting_arg });
+    }
+    std::cout << std::endl;
+
     return 0;
 }
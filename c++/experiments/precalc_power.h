@@ -0,0 +1,100 @@
+#pragma once
+
+/*
+ * Tables for the functions of the form c * n^p, as used by tuned_ratio_sample_sizes,
+ * which are built at compile time, so that no pow/log/exp is ever called at runtime.
+ *
+ * For n <= lo_max, the value is lo_mult * n^lo_power; for n >= hi_min, it is hi_mult * n^hi_power;
+ * in between, the two are interpolated linearly on the log-log scale. All these values are tabulated.
+ *
+ * For n > hi_min, n is split as 2^e * (1 + f), where f has mantissa_bits bits,
+ * and the value is approximated as the product of two tabulated values, (2^e)^p and (1 + f)^p.
+ * The relative error of this is at most about hi_power / 2^(mantissa_bits + 1).
+ */
+
+#include <array>
+#include <bit>
+#include <cstddef>
+
+namespace precalc_power_detail {
+    constexpr double ln_2 = 0.693147180559945309417232121458;
+
+    constexpr double const_exp(double x) {
+        // x = k * ln(2) + r, |r| <= ln(2) / 2
+        long k = long(x / ln_2 + (x < 0 ? -0.5 : 0.5));
+        double r = x - k * ln_2;
+        double sum = 1, term = 1;
+        for (int i = 1; i < 30; ++i) {
+            term *= r / i;
+            sum += term;
+        }
+        for (; k > 0; --k) sum *= 2;
+        for (; k < 0; ++k) sum /= 2;
+        return sum;
+    }
+
+    constexpr double const_log(double x) {
+        // x = 2^e * m, 1 <= m < 2, and log(m) = 2 atanh((m - 1) / (m + 1))
+        long e = 0;
+        for (; x >= 2; x /= 2) ++e;
+        for (; x < 1; x *= 2) --e;
+        double z = (x - 1) / (x + 1), z2 = z * z;
+        double sum = 0, power = z;
+        for (int i = 1; i < 60; i += 2) {
+            sum += power / i;
+            power *= z2;
+        }
+        return e * ln_2 + 2 * sum;
+    }
+
+    constexpr double const_pow(double x, double p) {
+        return const_exp(p * const_log(x));
+    }
+}
+
+template<size_t lo_max, size_t hi_min, unsigned mantissa_bits = 8>
+struct precalc_double_power {
+    static_assert(0 < lo_max && lo_max < hi_min);
+    static constexpr size_t n_mantissas = size_t(1) << mantissa_bits;
+
+    std::array<double, hi_min + 1> precalc;
+    std::array<double, 64> hi_exponent_values;
+    std::array<double, n_mantissas> hi_mantissa_values;
+
+    constexpr precalc_double_power(double lo_power, double lo_mult, double hi_power, double hi_mult)
+      : precalc(), hi_exponent_values(), hi_mantissa_values() {
+        using namespace precalc_power_detail;
+        for (size_t n = 1; n <= lo_max; ++n) {
+            precalc[n] = const_pow(n, lo_power) * lo_mult;
+        }
+        precalc[hi_min] = const_pow(hi_min, hi_power) * hi_mult;
+        double log_lo_max = const_log(lo_max);
+        double log_hi_min = const_log(hi_min);
+        double log_lo_val = const_log(precalc[lo_max]);
+        double log_hi_val = const_log(precalc[hi_min]);
+        for (size_t n = lo_max + 1; n < hi_min; ++n) {
+            double x = (const_log(n) - log_lo_max) / (log_hi_min - log_lo_max);
+            double y = log_lo_val + x * (log_hi_val - log_lo_val);
+            precalc[n] = const_exp(y);
+        }
+        for (size_t e = 0; e < hi_exponent_values.size(); ++e) {
+            hi_exponent_values[e] = const_exp(e * ln_2 * hi_power) * hi_mult;
+        }
+        for (size_t m = 0; m < n_mantissas; ++m) {
+            // the middle of the range of mantissas which fall into this entry
+            hi_mantissa_values[m] = const_pow(1 + (m + 0.5) / n_mantissas, hi_power);
+        }
+    }
+
+    constexpr double value(size_t n) const {
+        if (n <= hi_min) {
+            return precalc[n];
+        }
+        unsigned e = std::bit_width(n) - 1;
+        size_t mantissa = e >= mantissa_bits ? n >> (e - mantissa_bits) : n << (mantissa_bits - e);
+        return hi_exponent_values[e] * hi_mantissa_values[mantissa & (n_mantissas - 1)];
+    }
+};
+
+inline constexpr precalc_double_power<100, 1000> guess_x(0.9, 0.63,  0.58, 1.29);
+inline constexpr precalc_double_power<100, 1000> guess_y(0.8, 0.63,  1.0 / 3, 1.3);
@@ -0,0 +1,114 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "kth_statistic.h"
+#include "kth_statistic_stl.h"
+#include "kth_statistic_predictor_simple.h"
+#include "kth_statistic_sliding.h"
+
+/*
+ * Rolling medians of a stream: the incremental sliding_kth_statistic
+ * against copying every window and calling find on it.
+ */
+template<typename element_t>
+void measure(char const *measurement_name, std::vector<element_t> const &stream, size_t window,
+             sliding_kth_statistic<element_t> &sliding, std::vector< kth_statistic<element_t>* > const &algorithms) {
+    size_t steps = stream.size() - window;
+    size_t k = window / 2;
+    std::cout << "Measurement '" << measurement_name
+              << "', window = " << window
+              << ", k = " << k
+              << ", steps = " << steps
+              << ":" << std::endl;
+
+    size_t algo_width = strlen(sliding.name());
+    for (auto algorithm : algorithms) {
+        algo_width = std::max(algo_width, strlen(algorithm->name()));
+    }
+
+    std::vector<element_t> expected(steps), results(steps);
+    auto report = [&](char const *name, std::chrono::duration<double> const &elapsed_seconds) {
+        const std::chrono::duration<double> normalized = elapsed_seconds / double(steps);
+        std::cout << "    " << std::setw(algo_width) << name
+                  << ": " << std::setprecision(4) << std::scientific << elapsed_seconds
+                  << ", " << std::setprecision(4) << std::scientific << normalized
+                  << " per step" << std::endl;
+    };
+
+    sliding.clear();
+    for (size_t i = 0; i < window; ++i) {
+        sliding.push(stream[i]);
+    }
+    {
+        const auto start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < steps; ++i) {
+            sliding.pop();
+            sliding.push(stream[window + i]);
+            expected[i] = sliding.query(k);
+        }
+        const auto finish = std::chrono::high_resolution_clock::now();
+        report(sliding.name(), finish - start);
+        sliding.display_and_reset_statistics(std::cout);
+    }
+
+    std::vector<element_t> working(window);
+    for (kth_statistic<element_t> *algorithm : algorithms) {
+        algorithm->resize(window);
+        const auto start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < steps; ++i) {
+            std::copy(stream.begin() + i + 1, stream.begin() + i + 1 + window, working.begin());
+            results[i] = algorithm->find(working.data(), window, k);
+        }
+        const auto finish = std::chrono::high_resolution_clock::now();
+        if (results != expected) {
+            std::cerr << "Error: results are different between " << sliding.name()
+                      << " and " << algorithm->name() << std::endl;
+            std::exit(1);
+        }
+        report(algorithm->name(), finish - start);
+    }
+}
+
+int main() {
+    std::mt19937_64 rng(12314342342342LL);
+
+    tuned_ratio_sample_sizes tss;
+    sliding_kth_statistic<double> sliding("sliding window kth");
+    stl_kth_statistic<double> stl;
+    predicting_kth_statistic<double> predicting(tss, "simple predicting kth, tuned");
+    std::vector< kth_statistic<double>* > algorithms { &stl, &predicting };
+
+    std::uniform_real_distribution<double> uniform(-1.0, +1.0);
+    std::normal_distribution<double> step(0.0, 1.0);
+    std::uniform_int_distribution<int> few_unique(0, 9);
+
+    for (size_t window = 1000; window <= 100000; window *= 10) {
+        // repeated find does about 2e8 element operations in total
+        std::vector<double> stream(window + 200000000 / window);
+
+        for (double &value : stream) {
+            value = uniform(rng);
+        }
+        measure("UniformDouble[-1, +1]", stream, window, sliding, algorithms);
+
+        double walk = 0;
+        for (double &value : stream) {
+            walk += step(rng);
+            value = walk;
+        }
+        measure("RandomWalkDouble", stream, window, sliding, algorithms);
+
+        // runs of equal elements much larger than a bucket
+        for (double &value : stream) {
+            value = few_unique(rng);
+        }
+        measure("UniformInt[0, 9] as double", stream, window, sliding, algorithms);
+        std::cout << std::endl;
+    }
+    return 0;
+}
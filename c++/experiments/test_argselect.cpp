@@ -0,0 +1,44 @@
+#include "tests.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <limits>
+#include <vector>
+
+void test_random_argselect(kth_argselect<int> *algorithm, size_t size, size_t count, size_t seed) {
+    algorithm->resize(size);
+
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<size_t> pos_gen(0, size - 1);
+    std::uniform_int_distribution<int> val_gen(std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
+    std::uniform_int_distribution<int> repeated_val_gen(0, int(size / 10));
+
+    std::vector<int> keys(size), sorted(size);
+    // the payload column: where the key would be if the columns were reversed
+    std::vector<size_t> payloads(size);
+    for (size_t i = 0; i < size; ++i) {
+        payloads[i] = size - 1 - i;
+    }
+
+    for (size_t attempt = 0; attempt < count; ++attempt) {
+        size_t k = pos_gen(rng);
+        bool repeated = attempt % 2 == 1;
+        for (size_t i = 0; i < size; ++i) {
+            keys[i] = repeated ? repeated_val_gen(rng) : val_gen(rng);
+        }
+        sorted = keys;
+        std::nth_element(sorted.begin(), sorted.begin() + k, sorted.end());
+
+        size_t index = algorithm->find_index(keys.data(), size, k);
+        size_t payload = algorithm->find_payload(keys.data(), payloads.data(), size, k);
+        if (index >= size || keys[index] != sorted[k] || keys[size - 1 - payload] != sorted[k]) {
+            std::cerr << "[test_random_argselect, " << algorithm->name()
+                      << "] Expected " << sorted[k] << ", found index " << index
+                      << " and payload " << payload << " on test with k = " << k << std::endl;
+            std::cerr << "    Seed was " << seed << ", attempt was " << attempt << std::endl;
+            std::exit(1);
+        }
+    }
+}
@@ -0,0 +1,250 @@
+#include "tests.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+#include "kth_statistic_filters.h"
+#include "kth_statistic_filters_simd.h"
+
+/*
+ * The vectorized kernels of every instruction set which the CPU supports, against the scalar ones,
+ * for all four element types, whichever of them the engines would pick: every length up to max_length,
+ * so that all the tails are covered, both out of place and in place, with many equal elements,
+ * and with NaNs for the floating point types. Past the returned end, the kernels may write only
+ * up to dest + (until - from), which is checked with a guard zone after it.
+ */
+namespace {
+
+constexpr size_t max_length = 300;
+constexpr size_t guard = 64;
+constexpr size_t tries_per_length = 3;
+
+template<typename element_t>
+char const *type_name() {
+    if constexpr (std::is_same_v<element_t, int32_t>) return "int32";
+    if constexpr (std::is_same_v<element_t, int64_t>) return "int64";
+    if constexpr (std::is_same_v<element_t, float>) return "float";
+    return "double";
+}
+
+template<typename element_t>
+bool same(element_t a, element_t b) {
+    return a == b || (a != a && b != b);
+}
+
+template<typename element_t>
+struct kernel_checker {
+    filter_kernel_set<element_t> const &scalar, &simd;
+    char const *isa;
+    std::mt19937_64 rng;
+    size_t length;
+
+    kernel_checker(filter_kernel_set<element_t> const &scalar, filter_kernel_set<element_t> const &simd,
+                   char const *isa, size_t seed)
+    : scalar(scalar), simd(simd), isa(isa), rng(seed), length(0) {}
+
+    [[noreturn]] void fail(char const *kernel, char const *what) {
+        std::cerr << "[test_filter_kernels, " << isa << ", " << type_name<element_t>() << "] " << kernel
+                  << ": " << what << " differs from the scalar kernel on length " << length << std::endl;
+        std::exit(1);
+    }
+
+    // Small values, so that the bounds are often equal to elements, the extremes, and NaNs if there are any
+    element_t value() {
+        std::uniform_int_distribution<int> kind_gen(0, 19);
+        std::uniform_int_distribution<int> small_gen(-20, 20);
+        int kind = kind_gen(rng);
+        if (kind == 0) {
+            return std::numeric_limits<element_t>::lowest();
+        } else if (kind == 1) {
+            return std::numeric_limits<element_t>::max();
+        } else if (kind == 2 && std::numeric_limits<element_t>::has_quiet_NaN) {
+            return std::numeric_limits<element_t>::quiet_NaN();
+        }
+        return element_t(small_gen(rng));
+    }
+
+    element_t bound() {
+        element_t result;
+        do {
+            result = value();
+        } while (result != result);
+        return result;
+    }
+
+    std::vector<element_t> input() {
+        std::vector<element_t> result(length);
+        for (element_t &x : result) {
+            x = value();
+        }
+        return result;
+    }
+
+    // The outputs of a filter, by both kernels, either into a separate array or over the input itself
+    template<typename run_t>
+    void check_filter(char const *kernel, run_t run) {
+        std::vector<element_t> in = input();
+        for (bool in_place : { false, true }) {
+            std::vector<element_t> out[2];
+            size_t n_out[2];
+            for (size_t which = 0; which < 2; ++which) {
+                filter_kernel_set<element_t> const &kernels = which == 0 ? scalar : simd;
+                std::vector<element_t> &buffer = out[which];
+                buffer.assign(length + guard, element_t(77));
+                element_t *dest = buffer.data();
+                element_t const *from = in.data();
+                if (in_place) {
+                    std::copy(in.begin(), in.end(), buffer.begin());
+                    from = buffer.data();
+                }
+                element_t *end = run(kernels, from, from + length, dest);
+                n_out[which] = end - dest;
+                if (!std::all_of(buffer.begin() + length, buffer.end(), [](element_t x) { return x == element_t(77); })) {
+                    fail(kernel, "a write past dest + (until - from)");
+                }
+            }
+            if (n_out[0] != n_out[1]) {
+                fail(kernel, in_place ? "the number of elements in place" : "the number of elements");
+            }
+            for (size_t i = 0; i < n_out[0]; ++i) {
+                if (!same(out[0][i], out[1][i])) {
+                    fail(kernel, in_place ? "an element in place" : "an element");
+                }
+            }
+        }
+    }
+
+    void check_not_greater() {
+        element_t upper = bound();
+        check_filter("not_greater", [&](filter_kernel_set<element_t> const &k, element_t const *from,
+                                        element_t const *until, element_t *dest) {
+            return k.not_greater(from, until, upper, dest);
+        });
+    }
+
+    void check_not_less() {
+        element_t lower = bound();
+        check_filter("not_less", [&](filter_kernel_set<element_t> const &k, element_t const *from,
+                                     element_t const *until, element_t *dest) {
+            return k.not_less(from, until, lower, dest);
+        });
+    }
+
+    void check_between() {
+        element_t lower = bound(), upper = bound();
+        if (upper < lower) {
+            std::swap(lower, upper);
+        }
+        size_t n_less[2] = { 5, 5 }, which = 0;
+        check_filter("between", [&](filter_kernel_set<element_t> const &k, element_t const *from,
+                                    element_t const *until, element_t *dest) {
+            return k.between(from, until, lower, upper, dest, n_less[which++ % 2]);
+        });
+        if (n_less[0] != n_less[1]) {
+            fail("between", "n_less");
+        }
+    }
+
+    void check_bands(bool inside_initially) {
+        std::uniform_int_distribution<size_t> n_bounds_gen(0, 4);
+        size_t n_bounds = n_bounds_gen(rng);
+        element_t bounds[4];
+        for (size_t i = 0; i < n_bounds; ++i) {
+            bounds[i] = bound();
+        }
+        std::sort(bounds, bounds + n_bounds);
+        size_t n_passed[2][4] = { { 0, 0, 0, 0 }, { 0, 0, 0, 0 } }, which = 0;
+        check_filter("bands", [&](filter_kernel_set<element_t> const &k, element_t const *from,
+                                  element_t const *until, element_t *dest) {
+            return k.bands(from, until, bounds, n_bounds, inside_initially, dest, n_passed[which++ % 2]);
+        });
+        if (!std::equal(n_passed[0], n_passed[0] + 4, n_passed[1])) {
+            fail("bands", "n_passed");
+        }
+    }
+
+    void check_count_less_equal() {
+        std::vector<element_t> in = input();
+        element_t v = bound();
+        size_t n_less[2] = { 3, 3 }, n_equal[2] = { 4, 4 };
+        scalar.count_less_equal(in.data(), in.data() + length, v, n_less[0], n_equal[0]);
+        simd.count_less_equal(in.data(), in.data() + length, v, n_less[1], n_equal[1]);
+        if (n_less[0] != n_less[1] || n_equal[0] != n_equal[1]) {
+            fail("count_less_equal", "a count");
+        }
+    }
+
+    // Here the length is the number of lines, and the pairs are random, in both orders
+    void check_compare_exchange_lines() {
+        constexpr size_t line = batch_line_bytes / sizeof(element_t);
+        size_t n_lines = std::max<size_t>(2, std::min<size_t>(length, 256));
+        std::uniform_int_distribution<size_t> line_gen(0, n_lines - 1);
+        std::vector<uint8_t> pairs;
+        for (size_t j = 0; j < 2 * n_lines; ++j) {
+            size_t a = line_gen(rng), b;
+            do {
+                b = line_gen(rng);
+            } while (a == b);
+            pairs.push_back(uint8_t(a));
+            pairs.push_back(uint8_t(b));
+        }
+        std::vector<element_t> lines[2];
+        lines[0].resize(n_lines * line);
+        for (element_t &x : lines[0]) {
+            x = value();
+        }
+        lines[1] = lines[0];
+        scalar.compare_exchange_lines(lines[0].data(), pairs.data(), pairs.size() / 2);
+        simd.compare_exchange_lines(lines[1].data(), pairs.data(), pairs.size() / 2);
+        for (size_t i = 0; i < lines[0].size(); ++i) {
+            if (!same(lines[0][i], lines[1][i])) {
+                fail("compare_exchange_lines", "an element");
+            }
+        }
+    }
+
+    void run() {
+        for (length = 0; length <= max_length; ++length) {
+            for (size_t t = 0; t < tries_per_length; ++t) {
+                check_not_greater();
+                check_not_less();
+                check_between();
+                check_count_less_equal();
+                check_bands(false);
+                check_bands(true);
+                check_compare_exchange_lines();
+            }
+        }
+    }
+};
+
+template<typename element_t>
+void test_kernels_of_type(size_t seed, bool has_avx2, bool has_avx512) {
+    static constexpr filter_kernel_set<element_t> scalar = scalar_filter_kernels<element_t>();
+    if (has_avx2) {
+        kernel_checker<element_t>(scalar, avx2_filter_kernels<element_t>(), "AVX2", seed).run();
+    }
+    if (has_avx512) {
+        kernel_checker<element_t>(scalar, avx512_filter_kernels<element_t>(), "AVX-512", seed + 1).run();
+    }
+}
+
+}
+
+void test_filter_kernels(size_t seed) {
+    __builtin_cpu_init();
+    bool has_avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+    bool has_avx512 = __builtin_cpu_supports("avx512f");
+    test_kernels_of_type<int32_t>(seed, has_avx2, has_avx512);
+    test_kernels_of_type<int64_t>(seed + 2, has_avx2, has_avx512);
+    test_kernels_of_type<float>(seed + 4, has_avx2, has_avx512);
+    test_kernels_of_type<double>(seed + 6, has_avx2, has_avx512);
+    std::cout << "filter kernels: test_filter_kernels OK ("
+              << (has_avx2 ? "AVX2" : "no AVX2") << ", " << (has_avx512 ? "AVX-512" : "no AVX-512") << ")" << std::endl;
+}
@@ -0,0 +1,35 @@
+#include "tests.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+void test_random_kd_tree(kth_statistic<int> *algorithm, size_t n, size_t dims, size_t count, size_t seed) {
+    // one builder for all attempts, so that its workspace is reused by the trees of all sizes
+    kd_tree_builder<int> builder(*algorithm, 4);
+
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<size_t> size_gen(1, n);
+    std::uniform_int_distribution<int> val_gen(-1000000, +1000000);
+    std::uniform_int_distribution<int> repeated_val_gen(0, 10);
+
+    std::vector<int> points;
+    std::vector<size_t> order;
+    for (size_t attempt = 0; attempt < count; ++attempt) {
+        size_t size = attempt == 0 ? n : size_gen(rng);
+        bool repeated = attempt % 2 == 1;
+        points.resize(size * dims);
+        for (int &coord : points) {
+            coord = repeated ? repeated_val_gen(rng) : val_gen(rng);
+        }
+        order.assign(size, 0);
+        builder.build(points.data(), size, dims, order.data());
+        if (!is_kd_tree(points.data(), size, dims, builder.leaf_size(), order.data())) {
+            std::cerr << "[test_random_kd_tree, " << algorithm->name()
+                      << "] Not a k-d tree of " << size << " points in " << dims << " dimensions" << std::endl;
+            std::cerr << "    Seed was " << seed << ", attempt was " << attempt << std::endl;
+            std::exit(1);
+        }
+    }
+}
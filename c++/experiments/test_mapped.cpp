@@ -0,0 +1,86 @@
+#include "tests.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "kth_statistic_mapped.h"
+#include "mapped_array.h"
+
+/*
+ * Every k of inputs on which the band misses often, so that the widening passes run,
+ * including the ones which make the band unbounded: few unique values, sorted values,
+ * and values with a period which divides the sampling stride, so that the sample sees a single phase of it.
+ * The few unique values are answered by the counts of the elements equal to the bounds, and a second engine,
+ * which may keep only a few elements in memory, has to narrow its bands.
+ */
+void test_random_mapped(sample_sizes &sizes, size_t size, size_t seed) {
+    mapped_predicting_kth_statistic<int> algorithm(sizes, "mapped predicting kth");
+    mapped_predicting_kth_statistic<int> capped(sizes, "mapped predicting kth, at most 16 elements in memory", 16);
+    std::string path = (std::filesystem::temp_directory_path() / "kth_statistic_test_mapped.bin").string();
+
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<int> few_gen(0, 3);
+    std::uniform_int_distribution<int> val_gen(-1000000, +1000000);
+    const size_t stride = size / std::max<size_t>(1, sizes.n_phase_1_samples(size));
+
+    char const *input_names[] = { "few unique", "sorted", "stride-periodic" };
+    std::vector<int> reference(size), working(size);
+    for (size_t input = 0; input < 3; ++input) {
+        for (size_t i = 0; i < size; ++i) {
+            reference[i] = input == 0 ? few_gen(rng)
+                         : input == 1 ? val_gen(rng)
+                         : int(i % stride) * 1000000 + val_gen(rng) % 1000;
+        }
+        if (input == 1) {
+            std::sort(reference.begin(), reference.end());
+        }
+        {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<char const *>(reference.data()), std::streamsize(size * sizeof(int)));
+            if (!out) {
+                std::cerr << "[test_random_mapped] Error: cannot write " << size << " elements to " << path << std::endl;
+                std::exit(1);
+            }
+        }
+        mapped_array<int> arr;
+        if (!arr.open(path.c_str()) || arr.size() != size) {
+            std::cerr << "[test_random_mapped] Error: cannot map " << path << std::endl;
+            std::exit(1);
+        }
+
+        for (size_t k = 0; k < size; ++k) {
+            working = reference;
+            std::nth_element(working.begin(), working.begin() + k, working.end());
+            for (mapped_predicting_kth_statistic<int> *engine : { &algorithm, &capped }) {
+                int result = engine->find(arr, k);
+                if (working[k] != result) {
+                    std::cerr << "[test_random_mapped, " << engine->name()
+                              << "] Expected " << working[k] << ", found " << result
+                              << " on " << input_names[input] << " input of size " << size << " with k = " << k << std::endl;
+                    std::cerr << "    Seed was " << seed << std::endl;
+                    std::exit(1);
+                }
+            }
+        }
+    }
+    std::filesystem::remove(path);
+
+    char const *error = nullptr;
+    if (algorithm.widenings() == 0 || capped.widenings() == 0) {
+        error = "the band was never widened";
+    } else if (algorithm.counted() == 0) {
+        error = "no find was answered by the counts";
+    } else if (capped.narrowings() == 0) {
+        error = "the band was never narrowed";
+    }
+    if (error != nullptr) {
+        std::cerr << "[test_random_mapped] Error: " << error << " (size " << size << ")" << std::endl;
+        std::exit(1);
+    }
+}
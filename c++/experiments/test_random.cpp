@@ -6,6 +6,8 @@
 #include <iostream>
 #include <random>
 #include <limits>
+#include <thread>
+#include <vector>
 
 void test_random_common(kth_statistic<int> *algorithm, char const *name,
                         size_t size, size_t count, size_t seed,
@@ -64,3 +66,191 @@ void test_random_repeated(kth_statistic<int> *algorithm, size_t size, size_t cou
 void test_random(kth_statistic<int> *algorithm, size_t size, size_t count, size_t seed) {
     test_random_common(algorithm, "test_random", size, count, seed);
 }
+
+
+void test_random_many(kth_statistic<int> *algorithm, size_t size, size_t count, size_t seed) {
+    test_common(algorithm, size, "test_random_many", 10000000);
+
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<size_t> pos_gen(0, size - 1);
+    std::uniform_int_distribution<size_t> n_ks_gen(1, 8);
+    std::uniform_int_distribution<int> val_gen(std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
+    std::uniform_int_distribution<int> repeated_val_gen(0, int(size / 10));
+
+    int *reference = new int[size];
+    int *working = new int[size];
+    size_t ks[8];
+    int results[8];
+
+    for (size_t attempt = 0; attempt < count; ++attempt) {
+        size_t n_ks = n_ks_gen(rng);
+        for (size_t i = 0; i < n_ks; ++i) {
+            ks[i] = pos_gen(rng);
+        }
+        bool repeated = attempt % 2 == 1;
+        for (size_t i = 0; i < size; ++i) {
+            reference[i] = repeated ? repeated_val_gen(rng) : val_gen(rng);
+            working[i] = reference[i];
+        }
+        std::vector<int> sorted(reference, reference + size);
+        std::sort(sorted.begin(), sorted.end());
+        algorithm->find_many(working, size, ks, n_ks, results);
+        for (size_t i = 0; i < n_ks; ++i) {
+            if (sorted[ks[i]] != results[i]) {
+                std::cerr << "[test_random_many, " << algorithm->name()
+                          << "] Expected " << sorted[ks[i]] << ", found " << results[i]
+                          << " on test with k = " << ks[i] << " (number " << i << " of " << n_ks << ")" << std::endl;
+                std::cerr << "    Seed was " << seed << ", attempt was " << attempt << std::endl;
+                std::exit(1);
+            }
+        }
+    }
+
+    delete[] reference;
+    delete[] working;
+}
+
+
+void test_random_partition(kth_statistic<int> *algorithm, size_t size, size_t count, size_t seed) {
+    test_common(algorithm, size, "test_random_partition", 10000000);
+
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<size_t> pos_gen(0, size - 1);
+    std::uniform_int_distribution<int> val_gen(std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
+    std::uniform_int_distribution<int> repeated_val_gen(0, int(size / 10));
+
+    std::vector<int> reference(size), working(size), sorted(size);
+
+    for (size_t attempt = 0; attempt < count; ++attempt) {
+        size_t k = pos_gen(rng);
+        bool repeated = attempt % 2 == 1;
+        for (size_t i = 0; i < size; ++i) {
+            reference[i] = repeated ? repeated_val_gen(rng) : val_gen(rng);
+        }
+        working = reference;
+        sorted = reference;
+        std::sort(sorted.begin(), sorted.end());
+        algorithm->partition_at(working.data(), size, k);
+
+        char const *error = nullptr;
+        if (working[k] != sorted[k]) {
+            error = "wrong k-th element";
+        } else if (std::any_of(working.begin(), working.begin() + k, [&](int x) { return x > working[k]; })) {
+            error = "greater element before k";
+        } else if (std::any_of(working.begin() + k + 1, working.end(), [&](int x) { return x < working[k]; })) {
+            error = "less element after k";
+        } else {
+            std::sort(working.begin(), working.end());
+            if (working != sorted) {
+                error = "not a permutation of the input";
+            }
+        }
+        if (error != nullptr) {
+            std::cerr << "[test_random_partition, " << algorithm->name()
+                      << "] Error: " << error << " on test with k = " << k << std::endl;
+            std::cerr << "    Seed was " << seed << ", attempt was " << attempt << std::endl;
+            std::exit(1);
+        }
+    }
+}
+
+
+void test_random_batch(kth_statistic<int> *algorithm, size_t size, size_t count, size_t seed) {
+    test_common(algorithm, size, "test_random_batch", 10000000);
+
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<size_t> pos_gen(0, size - 1);
+    // not a multiple of the groups, as a batch may not fill the last one
+    std::uniform_int_distribution<size_t> n_arrays_gen(1, 40);
+    std::uniform_int_distribution<int> val_gen(std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
+    std::uniform_int_distribution<int> repeated_val_gen(0, int(size / 10));
+
+    std::vector<int> reference, working, expected, results;
+    std::vector<int *> starts;
+
+    for (size_t attempt = 0; attempt < count; ++attempt) {
+        size_t k = pos_gen(rng);
+        size_t n_arrays = n_arrays_gen(rng);
+        bool repeated = attempt % 2 == 1;
+        reference.resize(n_arrays * size);
+        for (int &value : reference) {
+            value = repeated ? repeated_val_gen(rng) : val_gen(rng);
+        }
+        working = reference;
+        expected.resize(n_arrays);
+        for (size_t i = 0; i < n_arrays; ++i) {
+            std::nth_element(working.begin() + i * size, working.begin() + i * size + k, working.begin() + (i + 1) * size);
+            expected[i] = working[i * size + k];
+        }
+        working = reference;
+        starts.resize(n_arrays);
+        for (size_t i = 0; i < n_arrays; ++i) {
+            starts[i] = working.data() + i * size;
+        }
+        results.assign(n_arrays, 0);
+        algorithm->find_batch(starts.data(), n_arrays, size, k, results.data());
+        for (size_t i = 0; i < n_arrays; ++i) {
+            if (expected[i] != results[i]) {
+                std::cerr << "[test_random_batch, " << algorithm->name()
+                          << "] Expected " << expected[i] << ", found " << results[i]
+                          << " on test with k = " << k << " (array " << i << " of " << n_arrays << ")" << std::endl;
+                std::cerr << "    Seed was " << seed << ", attempt was " << attempt << std::endl;
+                std::exit(1);
+            }
+        }
+    }
+}
+
+
+// Every thread checks find and partition_at, by turns, on its own arrays, all on the same instance at once
+void test_random_concurrent(kth_statistic<int> *algorithm, size_t size, size_t count, size_t n_threads, size_t seed) {
+    test_common(algorithm, size, "test_random_concurrent", 10000000);
+
+    std::vector<size_t> failed_attempts(n_threads, count);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < n_threads; ++t) {
+        threads.emplace_back([=, &failed_attempts] {
+            std::mt19937_64 rng(seed + t);
+            std::uniform_int_distribution<size_t> pos_gen(0, size - 1);
+            std::uniform_int_distribution<int> val_gen(std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
+            std::uniform_int_distribution<int> repeated_val_gen(0, int(size / 10));
+            std::vector<int> reference(size), working(size);
+
+            for (size_t attempt = 0; attempt < count; ++attempt) {
+                size_t k = pos_gen(rng);
+                bool repeated = attempt % 4 >= 2;
+                for (size_t i = 0; i < size; ++i) {
+                    reference[i] = repeated ? repeated_val_gen(rng) : val_gen(rng);
+                }
+                working = reference;
+                std::nth_element(reference.begin(), reference.begin() + k, reference.end());
+                int expected = reference[k];
+                bool ok;
+                if (attempt % 2 == 0) {
+                    ok = algorithm->find(working.data(), size, k) == expected;
+                } else {
+                    algorithm->partition_at(working.data(), size, k);
+                    ok = working[k] == expected
+                        && std::none_of(working.begin(), working.begin() + k, [&](int x) { return x > expected; })
+                        && std::none_of(working.begin() + k + 1, working.end(), [&](int x) { return x < expected; });
+                }
+                if (!ok) {
+                    failed_attempts[t] = attempt;
+                    return;
+                }
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    for (size_t t = 0; t < n_threads; ++t) {
+        if (failed_attempts[t] != count) {
+            std::cerr << "[test_random_concurrent, " << algorithm->name()
+                      << "] Wrong result in thread " << t << " of " << n_threads << std::endl;
+            std::cerr << "    Seed was " << seed + t << ", attempt was " << failed_attempts[t] << std::endl;
+            std::exit(1);
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#include "tests.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <vector>
+
+void test_random_sliding(size_t max_window, size_t steps, size_t seed) {
+    sliding_kth_statistic<int> sliding("sliding window kth");
+
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<size_t> op_gen(0, 2);
+    std::uniform_int_distribution<int> val_gen(-1000000, +1000000);
+    std::uniform_int_distribution<int> repeated_val_gen(0, int(max_window / 10));
+    std::uniform_int_distribution<int> few_unique_val_gen(0, 3);
+    std::deque<int> window;
+    std::vector<int> sorted;
+
+    for (size_t step = 0; step < steps; ++step) {
+        // the window grows, stays around max_window and shrinks in turns, while the values drift,
+        // repeat, or are a few values only, so that runs of equal elements much larger than a bucket fill the window
+        size_t phase = step * 5 / steps;
+        bool do_push = window.empty() || (window.size() < max_window && (phase == 4 ? op_gen(rng) == 0 : op_gen(rng) != 0));
+        if (do_push) {
+            int drift = int(step / 16);
+            int value = phase == 0 || phase == 3 ? val_gen(rng) + drift
+                      : phase == 2 ? few_unique_val_gen(rng) : repeated_val_gen(rng);
+            window.push_back(value);
+            sliding.push(value);
+        } else {
+            window.pop_front();
+            sliding.pop();
+        }
+
+        if (sliding.size() != window.size()) {
+            std::cerr << "[test_random_sliding] Expected size " << window.size()
+                      << ", found " << sliding.size() << std::endl;
+            std::cerr << "    Seed was " << seed << ", step was " << step << std::endl;
+            std::exit(1);
+        }
+        if (!window.empty()) {
+            size_t k = std::uniform_int_distribution<size_t>(0, window.size() - 1)(rng);
+            sorted.assign(window.begin(), window.end());
+            std::nth_element(sorted.begin(), sorted.begin() + k, sorted.end());
+            int result = sliding.query(k);
+            if (result != sorted[k]) {
+                std::cerr << "[test_random_sliding] Expected " << sorted[k] << ", found " << result
+                          << " on test with k = " << k << ", window size " << window.size() << std::endl;
+                std::cerr << "    Seed was " << seed << ", step was " << step << std::endl;
+                std::exit(1);
+            }
+        }
+    }
+
+    // a rebuild takes O(max_window), so there must be O(sqrt(max_window)) steps between them, runs or not
+    size_t max_rebuilds = 16 + steps / std::max<size_t>(8, size_t(std::sqrt(double(max_window))));
+    if (sliding.rebuilds() > max_rebuilds) {
+        std::cerr << "[test_random_sliding] Error: " << sliding.rebuilds() << " rebuilds in " << steps
+                  << " steps, expected at most " << max_rebuilds << ", with the window up to " << max_window << std::endl;
+        std::cerr << "    Seed was " << seed << std::endl;
+        std::exit(1);
+    }
+}
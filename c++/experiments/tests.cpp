@@ -6,7 +6,15 @@
 
 #include "kth_statistic_stl.h"
 #include "kth_statistic_hoare.h"
+#include "kth_statistic_network.h"
+#include "kth_statistic_floyd_rivest.h"
 #include "kth_statistic_predictor_simple.h"
+#include "kth_statistic_predictor_destructive.h"
+#include "kth_statistic_predictor_parallel.h"
+#include "kth_statistic_radix.h"
+#include "kth_statistic_predictor_argselect.h"
+#include "kth_statistic_batch.h"
+#include "kth_statistic_concurrent.h"
 
 void test_all(kth_statistic<int> *algorithm) {
     const char *name = algorithm->name();
@@ -37,15 +45,69 @@ void test_all(kth_statistic<int> *algorithm) {
         test_random_repeated(algorithm, size, count, seed);
         std::cout << name << ": test_random_repeated OK (size " << size << ")" << std::endl;
     }
+
+    for (size_t idx = 0; idx < 6; ++idx) {
+        size_t size = rnd_sizes[idx];
+        size_t count = 1000000 / size;
+        size_t seed = 87512451357633 * (idx + 1);
+        test_random_many(algorithm, size, count, seed);
+        std::cout << name << ": test_random_many OK (size " << size << ")" << std::endl;
+    }
+
+    for (size_t idx = 0; idx < 6; ++idx) {
+        size_t size = rnd_sizes[idx];
+        size_t count = std::min<size_t>(10000, 1000000 / size);
+        size_t seed = 87512451357636 * (idx + 1);
+        test_random_partition(algorithm, size, count, seed);
+        std::cout << name << ": test_random_partition OK (size " << size << ")" << std::endl;
+    }
+}
+
+void test_all_argselect(kth_argselect<int> *algorithm) {
+    size_t sizes[] = { 1, 2, 3, 10, 100, 1000, 10000, 100000, 1000000 };
+    for (size_t idx = 0; idx < 9; ++idx) {
+        size_t size = sizes[idx];
+        size_t count = std::min<size_t>(1000, 10000000 / size);
+        size_t seed = 87512451357634 * (idx + 1);
+        test_random_argselect(algorithm, size, count, seed);
+        std::cout << algorithm->name() << ": test_random_argselect OK (size " << size << ")" << std::endl;
+    }
 }
 
 int main() {
+    test_filter_kernels(87512451357644);
+
     stl_kth_statistic<int> stl_int;
     test_all(&stl_int);
 
     bidirectional_hoare_middle<int> hoare_mid_int;
     test_all(&hoare_mid_int);
 
+    network_kth_statistic<int> network_int;
+    test_all(&network_int);
+    // the networks which test_all does not cover: exhaustively as far as it is quick, then randomly
+    for (size_t size = 17; size <= 20; ++size) {
+        test_all_01s(&network_int, size);
+    }
+    std::cout << network_int.name() << ": test_all_01s OK (sizes 17 to 20)" << std::endl;
+    for (size_t size = 21; size <= max_network_size; ++size) {
+        test_random(&network_int, size, 100000, 87512451357638 * size);
+        test_random_repeated(&network_int, size, 100000, 87512451357639 * size);
+    }
+    std::cout << network_int.name() << ": test_random OK (sizes 21 to " << max_network_size << ")" << std::endl;
+
+    introspective_hoare<int> intro_int;
+    test_all(&intro_int);
+
+    introspective_hoare<int> intro_mom_int("introspective Hoare, always median of medians", 0);
+    test_all(&intro_mom_int);
+
+    floyd_rivest_kth_statistic<int> floyd_rivest_int;
+    test_all(&floyd_rivest_int);
+
+    floyd_rivest_aux_kth_statistic<int> floyd_rivest_aux_int;
+    test_all(&floyd_rivest_aux_int);
+
     fixed_ratio_sample_sizes fss(10, 10);
     predicting_kth_statistic<int> predicting_int(fss, "simple predicting kth, fixed ratio");
     test_all(&predicting_int);
@@ -54,5 +116,123 @@ int main() {
     predicting_kth_statistic<int> predicting_int_tuned(tss, "simple predicting kth, tuned");
     test_all(&predicting_int_tuned);
 
+    profiled_sample_sizes pss;
+    pss.set(10, { { 10, 5, 5 }, { 1000, 16, 150 }, { 1000000, 100, 5000 } });
+    predicting_kth_statistic<int> predicting_int_profiled(pss, "simple predicting kth, profiled");
+    test_all(&predicting_int_profiled);
+
+    adaptive_sample_sizes ass;
+    predicting_kth_statistic<int> predicting_int_adaptive(ass, "simple predicting kth, adaptive");
+    test_all(&predicting_int_adaptive);
+
+    predicting_kth_statistic<int> recursive_int(fss, "recursive predicting kth, fixed ratio, depth 2", 1, 2);
+    test_all(&recursive_int);
+
+    fixed_ratio_policy<10, 10> frp;
+    predicting_kth_statistic<int, fixed_ratio_policy<10, 10> > predicting_int_fixed_policy(frp, "simple predicting kth, fixed ratio policy");
+    test_all(&predicting_int_fixed_policy);
+
+    tuned_ratio_policy trp;
+    predicting_kth_statistic<int, tuned_ratio_policy> predicting_int_tuned_policy(trp, "simple predicting kth, tuned policy");
+    test_all(&predicting_int_tuned_policy);
+
+    predicting_kth_statistic<int, tuned_ratio_policy, random_sampling> predicting_int_random(trp, "simple predicting kth, tuned policy, random sampling");
+    test_all(&predicting_int_random);
+
+    predicting_kth_statistic<int, tuned_ratio_policy, block_sampling> predicting_int_blocks(trp, "simple predicting kth, tuned policy, block sampling");
+    test_all(&predicting_int_blocks);
+
+    destructive_predicting_kth_statistic<int> destructive_int(fss, "destructive predicting kth, fixed ratio");
+    test_all(&destructive_int);
+
+    destructive_predicting_kth_statistic<int, tuned_ratio_policy> destructive_int_tuned_policy(trp, "destructive predicting kth, tuned policy");
+    test_all(&destructive_int_tuned_policy);
+
+    // one after another, these engines grow and reuse the same memory
+    workspace shared_workspace(page_policy::huge_pages);
+    predicting_kth_statistic<int> predicting_int_shared(tss, "simple predicting kth, tuned, shared workspace", 1, 0, &shared_workspace);
+    test_all(&predicting_int_shared);
+    predicting_kth_statistic<int> recursive_int_shared(tss, "recursive predicting kth, tuned, depth 2, shared workspace", 1, 2, &shared_workspace);
+    test_all(&recursive_int_shared);
+
+    thread_pool pool(4);
+    parallel_predicting_kth_statistic<int> parallel_int_tuned(tss, pool, "parallel predicting kth, tuned");
+    test_all(&parallel_int_tuned);
+
+    radix_kth_statistic<int, 8> radix_int_8("radix select, 8-bit digits");
+    test_all(&radix_int_8);
+
+    radix_kth_statistic<int, 11> radix_int_11("radix select, 11-bit digits");
+    test_all(&radix_int_11);
+
+    radix_kth_statistic<int, 11> radix_int_11_shared("radix select, 11-bit digits, shared workspace", 1, &shared_workspace);
+    test_all(&radix_int_11_shared);
+
+    // the default, a find for every array, and the networks, the samples and the engine for the largest
+    size_t batch_sizes[] = { 1, 2, 17, 64, 100, 255, 256, 257, 1000, max_batch_size, 3000 };
+    batched_kth_statistic<int> batched_int(predicting_int_tuned_policy, "batched, on simple predicting kth, tuned policy");
+    for (size_t idx = 0; idx < 11; ++idx) {
+        size_t size = batch_sizes[idx];
+        size_t count = std::min<size_t>(2000, 10000000 / 20 / size);
+        test_random_batch(&stl_int, size, count, 87512451357640 * (idx + 1));
+        test_random_batch(&batched_int, size, count, 87512451357640 * (idx + 1));
+    }
+    std::cout << batched_int.name() << ": test_random_batch OK" << std::endl;
+
+    // one instance for all the threads, with fewer slots than threads, so that they also wait for each other
+    concurrent_kth_statistic<int, tuned_ratio_policy> concurrent_int(trp, "concurrent predicting kth, tuned policy, 3 slots", 1, 0, 3);
+    test_all(&concurrent_int);
+    size_t concurrent_sizes[] = { 10, 100, 1000, 10000, 100000, 1000000 };
+    size_t concurrent_calls = 0, leases_before = concurrent_int.leases();
+    for (size_t idx = 0; idx < 6; ++idx) {
+        size_t size = concurrent_sizes[idx];
+        size_t count = std::min<size_t>(20000, 2000000 / size);
+        test_random_concurrent(&concurrent_int, size, count, 8, 87512451357641 * (idx + 1));
+        concurrent_calls += 8 * count;
+        std::cout << concurrent_int.name() << ": test_random_concurrent OK (size " << size << ")" << std::endl;
+    }
+    // every call is counted by the slot which it leased
+    if (concurrent_int.leases() - leases_before != concurrent_calls) {
+        std::cerr << "[" << concurrent_int.name() << "] Expected " << concurrent_calls << " leases, counted "
+                  << concurrent_int.leases() - leases_before << std::endl;
+        std::exit(1);
+    }
+    std::cout << concurrent_int.name() << ": lease count OK" << std::endl;
+
+    stl_argselect<int> stl_arg_int;
+    test_all_argselect(&stl_arg_int);
+
+    predicting_argselect<int> predicting_arg_int(fss, "simple predicting argselect, fixed ratio");
+    test_all_argselect(&predicting_arg_int);
+
+    predicting_argselect<int, tuned_ratio_policy> predicting_arg_int_tuned(trp, "simple predicting argselect, tuned policy");
+    test_all_argselect(&predicting_arg_int_tuned);
+
+    predicting_argselect<int, tuned_ratio_policy> predicting_arg_int_shared(trp, "simple predicting argselect, tuned policy, shared workspace", 1, &shared_workspace);
+    test_all_argselect(&predicting_arg_int_shared);
+
+    size_t mapped_sizes[] = { 1000, 3001 };
+    for (size_t idx = 0; idx < 2; ++idx) {
+        test_random_mapped(fss, mapped_sizes[idx], 87512451357642 * (idx + 1));
+        test_random_mapped(tss, mapped_sizes[idx], 87512451357643 * (idx + 1));
+    }
+    std::cout << "mapped predicting kth: test_random_mapped OK" << std::endl;
+
+    size_t windows[] = { 1, 10, 100, 1000, 10000 };
+    for (size_t idx = 0; idx < 5; ++idx) {
+        size_t window = windows[idx];
+        test_random_sliding(window, std::max<size_t>(50000, 5 * window), 87512451357635 * (idx + 1));
+        std::cout << "sliding window kth: test_random_sliding OK (window " << window << ")" << std::endl;
+    }
+
+    std::vector< kth_statistic<int>* > kd_tree_engines { &stl_int, &predicting_int_tuned, &predicting_int_tuned_policy,
+                                                         &destructive_int, &recursive_int, &radix_int_11 };
+    for (kth_statistic<int> *algorithm : kd_tree_engines) {
+        for (size_t dims = 1; dims <= 4; ++dims) {
+            test_random_kd_tree(algorithm, 100000, dims, 20, 87512451357637 * dims);
+        }
+        std::cout << algorithm->name() << ": test_random_kd_tree OK" << std::endl;
+    }
+
     return 0;
 }
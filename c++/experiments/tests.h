@@ -1,9 +1,22 @@
 #pragma once
 
 #include "kth_statistic.h"
+#include "kth_statistic_argselect.h"
+#include "kth_statistic_predictor_simple.h"
+#include "kth_statistic_sliding.h"
+#include "kd_tree.h"
 
+void test_filter_kernels(size_t seed);
 void test_common(kth_statistic<int> *algorithm, size_t size, char const *test_name, size_t max_size);
 void test_all_01s(kth_statistic<int> *algorithm, size_t size);
 void test_all_perms(kth_statistic<int> *algorithm, size_t size);
 void test_random(kth_statistic<int> *algorithm, size_t size, size_t count, size_t seed);
 void test_random_repeated(kth_statistic<int> *algorithm, size_t size, size_t count, size_t seed);
+void test_random_many(kth_statistic<int> *algorithm, size_t size, size_t count, size_t seed);
+void test_random_partition(kth_statistic<int> *algorithm, size_t size, size_t count, size_t seed);
+void test_random_batch(kth_statistic<int> *algorithm, size_t size, size_t count, size_t seed);
+void test_random_concurrent(kth_statistic<int> *algorithm, size_t size, size_t count, size_t n_threads, size_t seed);
+void test_random_argselect(kth_argselect<int> *algorithm, size_t size, size_t count, size_t seed);
+void test_random_mapped(sample_sizes &sizes, size_t size, size_t seed);
+void test_random_sliding(size_t max_window, size_t steps, size_t seed);
+void test_random_kd_tree(kth_statistic<int> *algorithm, size_t n, size_t dims, size_t count, size_t seed);
@@ -0,0 +1,98 @@
+#pragma once
+
+/*
+ * A minimal pool of worker threads for the experiments.
+ *
+ * run(n_tasks, task) calls task(i) for every i in [0, n_tasks) and returns when all calls complete.
+ * The calling thread takes part in the work, so a pool of one thread has no workers at all.
+ * Tasks are distributed statically: thread t runs tasks t, t + n_threads, t + 2 * n_threads, ...
+ */
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class thread_pool {
+    std::vector<std::thread> _workers;
+    std::mutex _mutex;
+    std::condition_variable _start, _finish;
+    std::function<void(size_t)> const *_task;
+    size_t _n_tasks, _generation, _running;
+    bool _shutdown;
+
+    void run_share(size_t thread_index, std::function<void(size_t)> const &task, size_t n_tasks) {
+        for (size_t i = thread_index; i < n_tasks; i += n_threads()) {
+            task(i);
+        }
+    }
+
+    void worker(size_t thread_index) {
+        size_t seen_generation = 0;
+        while (true) {
+            std::function<void(size_t)> const *task;
+            size_t n_tasks;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _start.wait(lock, [&] { return _shutdown || _generation != seen_generation; });
+                if (_shutdown) {
+                    return;
+                }
+                seen_generation = _generation;
+                task = _task;
+                n_tasks = _n_tasks;
+            }
+            run_share(thread_index, *task, n_tasks);
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (--_running == 0) {
+                    _finish.notify_one();
+                }
+            }
+        }
+    }
+
+public:
+    explicit thread_pool(size_t n_threads)
+    : _task(nullptr), _n_tasks(0), _generation(0), _running(0), _shutdown(false) {
+        for (size_t i = 1; i < n_threads; ++i) {
+            _workers.emplace_back(&thread_pool::worker, this, i);
+        }
+    }
+
+    thread_pool(thread_pool const &) = delete;
+    thread_pool &operator = (thread_pool const &) = delete;
+
+    size_t n_threads() const { return _workers.size() + 1; }
+
+    void run(size_t n_tasks, std::function<void(size_t)> const &task) {
+        if (n_tasks <= 1 || _workers.empty()) {
+            run_share(0, task, n_tasks);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _task = &task;
+            _n_tasks = n_tasks;
+            _running = _workers.size();
+            ++_generation;
+        }
+        _start.notify_all();
+        run_share(0, task, n_tasks);
+        std::unique_lock<std::mutex> lock(_mutex);
+        _finish.wait(lock, [&] { return _running == 0; });
+    }
+
+    ~thread_pool() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _shutdown = true;
+        }
+        _start.notify_all();
+        for (auto &worker : _workers) {
+            worker.join();
+        }
+    }
+};
@@ -1,4 +1,6 @@
 #include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
@@ -11,6 +13,7 @@
 #include "kth_statistic_stl.h"
 #include "kth_statistic_hoare.h"
 #include "kth_statistic_predictor_simple.h"
+#include "generators.h"
 #include "util.h"
 
 struct variable_ratio_sample_sizes : sample_sizes {
@@ -27,12 +30,6 @@ struct variable_ratio_sample_sizes : sample_sizes {
     size_t _phase_1_divisor, _phase_2_divisor;
 };
 
-template<typename element_t>
-struct sequence_changer {
-    virtual void generate(element_t *array, size_t size) = 0;
-    virtual ~sequence_changer() {}
-};
-
 template<typename element_t>
 class performance_test {
     char const * const measurement_name;
@@ -124,31 +121,251 @@ public:
     }
 };
 
-template<typename element_t, typename rng_t>
-struct uniform_int_generator : sequence_changer<element_t> {
-    rng_t &rng;
-    element_t min, max;
+/*
+ * The autotuner: `tuning.exe --autotune <profile>` fits the sample sizes to this machine
+ * and writes them as a profile for profiled_sample_sizes.
+ *
+ * For every size in a geometric sweep, it searches for the divisors n / phase_1 and n / (phase_2 - 1)
+ * which minimize the time of predicting_kth_statistic, summed over the element types and several values of k.
+ * The search is a coordinate descent on a geometric grid of divisors, starting from tuned_ratio_sample_sizes.
+ * Every type contributes its time relative to the starting point, so that the faster types are not ignored.
+ * The optimal divisors are noisy, as the time is flat around the optimum, so the fitted curve is
+ * their running median over the neighbouring sizes. The smallest size is also fitted:
+ * it is the smallest swept size from which on the best predicting time is less than that of std::nth_element.
+ */
+
+struct trial_sample_sizes : sample_sizes {
+    bool is_size_acceptable(size_t n) {
+        return n >= 2;
+    }
+    size_t n_phase_1_samples(size_t n) {
+        return std::max(size_t(1), size_t(n / _phase_1_divisor));
+    }
+    size_t n_phase_2_samples(size_t n, size_t phase_1) {
+        return std::min(phase_1, 1 + size_t(n / _phase_2_divisor));
+    }
+
+    double _phase_1_divisor, _phase_2_divisor;
+};
+
+struct autotune_workload {
+    virtual double time(trial_sample_sizes &sizes) = 0;
+    virtual double stl_time() = 0;
+    virtual ~autotune_workload() {}
+};
 
-    uniform_int_generator(rng_t &rng, element_t min, element_t max): rng(rng), min(min), max(max) {}
+template<typename element_t>
+class typed_autotune_workload : public autotune_workload {
+    static constexpr size_t n_repetitions = 3;
+
+    size_t const size, count;
+    std::vector<double> const &k_fractions;
+    std::vector< std::vector<element_t> > reference;
+    std::vector<element_t> working;
+    std::vector< std::vector<element_t> > expected;
 
-    void generate(element_t *array, size_t size) {
-        std::uniform_int_distribution<element_t> value_gen(min, max);
-        for (size_t i = 0; i < size; ++i) {
-            array[i] = value_gen(rng);
+    template<typename algorithm_t>
+    double measure(algorithm_t &algorithm) {
+        algorithm.resize(size);
+        double total = 0;
+        for (size_t f = 0; f < k_fractions.size(); ++f) {
+            size_t k = std::min(size - 1, size_t(k_fractions[f] * size));
+            double best = 0;
+            for (size_t rep = 0; rep < n_repetitions; ++rep) {
+                std::chrono::duration<double> elapsed(0);
+                for (size_t i = 0; i < count; ++i) {
+                    array_copy(reference[i].data(), size, working.data());
+                    const auto start = std::chrono::high_resolution_clock::now();
+                    element_t result = algorithm.find(working.data(), size, k);
+                    elapsed += std::chrono::high_resolution_clock::now() - start;
+                    if (result != expected[f][i]) {
+                        std::cerr << "Wrong result of " << algorithm.name() << " for size " << size << std::endl;
+                        std::exit(1);
+                    }
+                }
+                double seconds = elapsed.count() / double(size) / double(count);
+                best = rep == 0 ? seconds : std::min(best, seconds);
+            }
+            total += best;
         }
+        return total;
     }
-};
 
-template<typename element_t, typename comparator_t>
-struct sorter : sequence_changer<element_t> {
-    comparator_t cmp;
+public:
+    template<typename generator_t>
+    typed_autotune_workload(size_t size, size_t count, std::vector<double> const &k_fractions, generator_t &generator)
+    : size(size), count(count), k_fractions(k_fractions), reference(count), working(size), expected(k_fractions.size()) {
+        for (size_t i = 0; i < count; ++i) {
+            reference[i].resize(size);
+            generator.generate(reference[i].data(), size);
+        }
+        for (size_t f = 0; f < k_fractions.size(); ++f) {
+            size_t k = std::min(size - 1, size_t(k_fractions[f] * size));
+            for (size_t i = 0; i < count; ++i) {
+                array_copy(reference[i].data(), size, working.data());
+                std::nth_element(working.begin(), working.begin() + k, working.end());
+                expected[f].push_back(working[k]);
+            }
+        }
+    }
+
+    double time(trial_sample_sizes &sizes) {
+        predicting_kth_statistic<element_t> algorithm(sizes, "autotuned");
+        return measure(algorithm);
+    }
 
-    void generate(element_t *array, size_t size) {
-        std::sort(array, array + size, cmp);
+    double stl_time() {
+        stl_kth_statistic<element_t> algorithm;
+        return measure(algorithm);
     }
 };
 
+struct autotune_result {
+    size_t size;
+    double phase_1_divisor, phase_2_divisor;
+    double start_cost, best_cost, stl_cost;
+};
+
+autotune_result autotune_size(size_t size, std::vector<autotune_workload*> const &workloads) {
+    // the grid of divisors is 2^(i / steps_per_octave)
+    const double steps_per_octave = 4;
+    const int max_iterations = 40;
+    auto divisor = [&](int i) { return std::exp2(i / steps_per_octave); };
+    auto grid = [&](double d) { return int(std::lround(std::log2(d) * steps_per_octave)); };
+
+    const int max_phase_1 = grid(size / 2.0), max_phase_2 = grid(double(size));
+    std::map< std::pair<int, int>, double > cache;
+    std::vector<double> start_times(workloads.size());
+    trial_sample_sizes sizes;
+
+    auto cost = [&](int i1, int i2) {
+        auto key = std::make_pair(i1, i2);
+        auto found = cache.find(key);
+        if (found != cache.end()) {
+            return found->second;
+        }
+        sizes._phase_1_divisor = divisor(i1);
+        sizes._phase_2_divisor = divisor(i2);
+        double result = 0;
+        for (size_t w = 0; w < workloads.size(); ++w) {
+            double t = workloads[w]->time(sizes);
+            if (cache.empty()) {
+                start_times[w] = t;
+            }
+            result += t / start_times[w];
+        }
+        return cache[key] = result;
+    };
+
+    int i1 = std::clamp(grid(guess_y.value(size)), 0, max_phase_1);
+    int i2 = std::clamp(grid(guess_x.value(size)), 0, max_phase_2);
+    double best = cost(i1, i2);
+    const double start_cost = best;
+    for (int iteration = 0; iteration < max_iterations; ++iteration) {
+        int best_i1 = i1, best_i2 = i2;
+        const int moves[4][2] = { { -1, 0 }, { +1, 0 }, { 0, -1 }, { 0, +1 } };
+        for (auto const &move : moves) {
+            int j1 = i1 + move[0], j2 = i2 + move[1];
+            if (j1 < 0 || j1 > max_phase_1 || j2 < 0 || j2 > max_phase_2) {
+                continue;
+            }
+            double c = cost(j1, j2);
+            if (c < best) {
+                best = c;
+                best_i1 = j1;
+                best_i2 = j2;
+            }
+        }
+        if (best_i1 == i1 && best_i2 == i2) {
+            break;
+        }
+        i1 = best_i1;
+        i2 = best_i2;
+    }
+
+    double stl = 0;
+    for (size_t w = 0; w < workloads.size(); ++w) {
+        stl += workloads[w]->stl_time() / start_times[w];
+    }
+    return { size, divisor(i1), divisor(i2), start_cost, best, stl };
+}
+
+template<typename element_t, typename generator_t>
+void add_autotune_workload(std::vector<autotune_workload*> &workloads, size_t size, size_t elements,
+                           std::vector<double> const &k_fractions, generator_t &generator) {
+    size_t count = std::max(size_t(1), elements / size);
+    workloads.push_back(new typed_autotune_workload<element_t>(size, count, k_fractions, generator));
+}
+
+int autotune(char const *program, char const *profile, size_t min_size, size_t max_size, size_t elements) {
+    std::mt19937_64 rng(12314342342342LL);
+    uniform_int_generator<int, std::mt19937_64> gen_int(rng, -1000000000, +1000000000);
+    uniform_int_generator<int64_t, std::mt19937_64> gen_int64(rng, -1000000000000000000LL, +1000000000000000000LL);
+    uniform_real_generator<float, std::mt19937_64> gen_float(rng, -1, +1);
+    uniform_real_generator<double, std::mt19937_64> gen_double(rng, -1, +1);
+    std::vector<double> k_fractions = { 0.01, 0.25, 0.5 };
+
+    std::cout << "size,phase_1_divisor,phase_2_divisor,tuned_cost,best_cost,stl_cost" << std::endl;
+    std::vector<autotune_result> results;
+    for (double s = double(min_size); s <= double(max_size) * 1.0001; s *= std::sqrt(10.0)) {
+        size_t size = size_t(std::llround(s));
+        std::vector<autotune_workload*> workloads;
+        add_autotune_workload<int>(workloads, size, elements, k_fractions, gen_int);
+        add_autotune_workload<int64_t>(workloads, size, elements, k_fractions, gen_int64);
+        add_autotune_workload<float>(workloads, size, elements, k_fractions, gen_float);
+        add_autotune_workload<double>(workloads, size, elements, k_fractions, gen_double);
+
+        autotune_result r = autotune_size(size, workloads);
+        results.push_back(r);
+        std::cout << r.size << "," << std::setprecision(4) << std::fixed << r.phase_1_divisor << "," << r.phase_2_divisor
+                  << "," << r.start_cost << "," << r.best_cost << "," << r.stl_cost << std::endl;
+
+        for (autotune_workload *w : workloads) {
+            delete w;
+        }
+    }
+
+    // the running median of three, except at the ends
+    std::vector<profiled_sample_sizes::point> points;
+    for (size_t i = 0; i < results.size(); ++i) {
+        bool inner = i > 0 && i + 1 < results.size();
+        size_t from = inner ? i - 1 : i, until = inner ? i + 2 : i + 1;
+        std::vector<double> p1, p2;
+        for (size_t j = from; j < until; ++j) {
+            p1.push_back(results[j].phase_1_divisor);
+            p2.push_back(results[j].phase_2_divisor);
+        }
+        std::sort(p1.begin(), p1.end());
+        std::sort(p2.begin(), p2.end());
+        points.push_back({ results[i].size, p1[p1.size() / 2], p2[p2.size() / 2] });
+    }
+
+    size_t fitted_min_size = results.empty() ? min_size : results.back().size;
+    for (size_t i = results.size(); i-- > 0 && results[i].best_cost < results[i].stl_cost; ) {
+        fitted_min_size = results[i].size;
+    }
+
+    profiled_sample_sizes fitted;
+    fitted.set(fitted_min_size, points);
+    if (!fitted.save(profile)) {
+        std::cerr << program << ": cannot write " << profile << std::endl;
+        return 1;
+    }
+    std::cout << "Profile written to " << profile << " (min size " << fitted.min_size() << ")" << std::endl;
+    return 0;
+}
+
 int main(int argc, char *argv[]) {
+    if (argc >= 3 && std::strcmp(argv[1], "--autotune") == 0) {
+        size_t max_size = argc >= 4 ? size_t(std::atof(argv[3])) : 100000000;
+        size_t elements = argc >= 5 ? size_t(std::atof(argv[4])) : 1000000;
+        if (argc > 5 || max_size < 10 || elements == 0) {
+            std::cerr << "Usage: " << argv[0] << " --autotune <profile> [<max size> [<elements per measurement>]]" << std::endl;
+            std::exit(1);
+        }
+        return autotune(argv[0], argv[2], 10, max_size, elements);
+    }
+
     std::mt19937_64 rng(12314342342342LL);
 
     variable_ratio_sample_sizes vss;
@@ -157,17 +374,31 @@ int main(int argc, char *argv[]) {
     uniform_int_generator<int, std::mt19937_64> gen_1(rng, -1000000000, +1000000000);
     sorter<int, std::less<int> > int_increasing_sorter;
     sorter<int, std::greater<int> > int_decreasing_sorter;
+    few_unique_generator<int, std::mt19937_64> gen_few(rng, 10);
+    zipf_generator<int, std::mt19937_64> gen_zipf(rng, 10000, 1.1);
+    organ_pipe<int> int_organ_pipe;
+    sawtooth<int> int_sawtooth(16);
+    random_swapper<int, std::mt19937_64> int_swapper(rng, 1);
+    tuned_ratio_sample_sizes tss;
+    stride_periodic_generator<int, std::mt19937_64> gen_stride(rng, tss, 1000000);
 
     std::vector< std::pair< char const *, std::vector< sequence_changer<int>* > > > tests = {
         { "UniformInt[-1e9, +1e9]", { &gen_1 } },
         { "UniformIntInc[-1e9, +1e9]", { &gen_1, &int_increasing_sorter } },
-        { "UniformIntDec[-1e9, +1e9]", { &gen_1, &int_decreasing_sorter } }
+        { "UniformIntDec[-1e9, +1e9]", { &gen_1, &int_decreasing_sorter } },
+        { "FewUniqueInt[10]", { &gen_few } },
+        { "ZipfInt[1e4, 1.1]", { &gen_zipf } },
+        { "OrganPipeInt[-1e9, +1e9]", { &gen_1, &int_organ_pipe } },
+        { "SawtoothInt[-1e9, +1e9, 16 teeth]", { &gen_1, &int_sawtooth } },
+        { "NearlySortedInt[-1e9, +1e9, 1% swaps]", { &gen_1, &int_increasing_sorter, &int_swapper } },
+        { "StridePeriodicInt[tuned stride]", { &gen_stride } }
     };
 
     size_t size, test_no;
 
     if (argc != 3 || (size = atoi(argv[1])) == 0 || (test_no = atoi(argv[2])) >= tests.size()) {
         std::cerr << "Usage: " << argv[0] << " <size> <generator number>" << std::endl;
+        std::cerr << "    or " << argv[0] << " --autotune <profile> [<max size> [<elements per measurement>]]" << std::endl;
         std::cerr << "   where <generator number> is one of" << std::endl;
         for (size_t i = 0; i < tests.size(); ++i) {
             std::cerr << "    " << i << ": " << tests[i].first << std::endl;
@@ -0,0 +1,148 @@
+#pragma once
+
+/*
+ * A workspace: the aux memory of the selection engines, which several engines can share.
+ *
+ * get<element_t>(n) returns memory for at least n elements of any type. The memory only grows, and
+ * when it grows, it does so at least twice, so it is reallocated only a logarithmic number of times,
+ * however often the engines are resized. The contents are not kept when it grows,
+ * and the pointers returned before are then invalid, so the engines ask for the memory on every call,
+ * which is only a comparison if it is large enough. Hence, the engines which share a workspace
+ * must not be used at the same time, such as from different threads, or from one another.
+ *
+ * The memory comes either from the heap, or from mmap, where it is advised to use either
+ * only the normal (4K) pages, or the transparent huge pages (2M on x86-64). The latter
+ * makes a TLB entry cover 512 times more memory, which matters for buffers of many megabytes,
+ * whose every access would otherwise miss the TLB. Whether huge pages are actually used
+ * depends on the kernel (see /sys/kernel/mm/transparent_hugepage/enabled); huge_page_bytes() tells.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+enum class page_policy { heap, small_pages, huge_pages };
+
+class workspace {
+    static constexpr size_t alignment = 64;
+    static constexpr size_t huge_page_size = size_t(2) << 20;
+
+    page_policy _policy;
+    char *_mem;
+    size_t _bytes;
+    // what was actually mapped, which is more than _bytes to align the huge pages
+    void *_mapped;
+    size_t _mapped_bytes;
+    size_t _grows;
+
+    void release() {
+        if (_mem == nullptr) {
+            return;
+        }
+#ifdef __linux__
+        if (_mapped != nullptr) {
+            munmap(_mapped, _mapped_bytes);
+        } else
+#endif
+        {
+            ::operator delete[](_mem, std::align_val_t(alignment));
+        }
+        _mem = nullptr;
+        _mapped = nullptr;
+        _bytes = 0;
+        _mapped_bytes = 0;
+    }
+
+    void allocate(size_t bytes) {
+#ifdef __linux__
+        if (_policy != page_policy::heap) {
+            bool huge = _policy == page_policy::huge_pages;
+            size_t granularity = huge ? huge_page_size : size_t(4096);
+            bytes = (bytes + granularity - 1) / granularity * granularity;
+            _mapped_bytes = bytes + (huge ? huge_page_size : 0);
+            void *mapped = mmap(nullptr, _mapped_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (mapped == MAP_FAILED) {
+                std::cerr << "Error: cannot map " << _mapped_bytes << " bytes for a workspace" << std::endl;
+                std::exit(1);
+            }
+            _mapped = mapped;
+            uintptr_t start = reinterpret_cast<uintptr_t>(mapped);
+            start = (start + granularity - 1) / granularity * granularity;
+            _mem = reinterpret_cast<char *>(start);
+            _bytes = bytes;
+            // only an advice: if the kernel does not support it, the memory is still usable
+            madvise(_mem, _bytes, huge ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+            return;
+        }
+#endif
+        _mem = static_cast<char *>(::operator new[](bytes, std::align_val_t(alignment)));
+        _bytes = bytes;
+    }
+
+public:
+    // Without mmap, the page policies other than heap are the same as heap
+    explicit workspace(page_policy policy = page_policy::heap)
+    : _policy(policy), _mem(nullptr), _bytes(0), _mapped(nullptr), _mapped_bytes(0), _grows(0) {}
+
+    workspace(workspace const &) = delete;
+    workspace &operator = (workspace const &) = delete;
+
+    ~workspace() {
+        release();
+    }
+
+    page_policy policy() const { return _policy; }
+    size_t capacity() const { return _bytes; }
+    size_t grows() const { return _grows; }
+
+    // Memory for at least n elements, valid until the next call which needs more
+    template<typename element_t>
+    element_t *get(size_t n) {
+        size_t bytes = std::max(size_t(1), n) * sizeof(element_t);
+        if (bytes > _bytes) {
+            size_t new_bytes = std::max(bytes, 2 * _bytes);
+            release();
+            allocate(new_bytes);
+            ++_grows;
+        }
+        return reinterpret_cast<element_t *>(_mem);
+    }
+
+    // How much of the memory is backed by huge pages now, as the kernel reports it (zero if unknown)
+    size_t huge_page_bytes() const {
+        size_t result = 0;
+#ifdef __linux__
+        if (_mapped == nullptr) {
+            return 0;
+        }
+        std::ifstream smaps("/proc/self/smaps");
+        std::string line;
+        uintptr_t mem_from = reinterpret_cast<uintptr_t>(_mem), mem_until = mem_from + _bytes;
+        bool inside = false;
+        while (std::getline(smaps, line)) {
+            uintptr_t from, until;
+            char dash;
+            // a mapping starts with a line like "7f0000000000-7f0000200000 rw-p ...", followed by lines like "Size: 4 kB"
+            std::istringstream header(line);
+            if (header >> std::hex >> from >> dash >> until && dash == '-') {
+                inside = from < mem_until && mem_from < until;
+                continue;
+            }
+            if (inside && line.compare(0, 14, "AnonHugePages:") == 0) {
+                result += std::strtoull(line.c_str() + 14, nullptr, 10) * 1024;
+            }
+        }
+#endif
+        return result;
+    }
+};